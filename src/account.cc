@@ -34,13 +34,19 @@
 #include "account.h"
 #include "post.h"
 #include "xact.h"
+#include "xdata.h"
 
 namespace ledger {
 
+xdata_table_t * current_xdata_table = NULL;
+
 account_t::~account_t()
 {
   TRACE_DTOR(account_t);
 
+  if (current_xdata_table)
+    current_xdata_table->accounts.erase(this);
+
   foreach (accounts_map::value_type& pair, accounts) {
     if (! pair.second->has_flags(ACCOUNT_TEMP) ||
         has_flags(ACCOUNT_TEMP)) {
@@ -127,11 +133,11 @@ void account_t::add_post(post_t * post)
 
   // Adding a new post changes the possible totals that may have been
   // computed before.
-  if (xdata_) {
-    xdata_->self_details.gathered     = false;
-    xdata_->self_details.calculated   = false;
-    xdata_->family_details.gathered   = false;
-    xdata_->family_details.calculated = false;
+  if (xdata_t * xd = find_xdata()) {
+    xd->self_details.gathered     = false;
+    xd->self_details.calculated   = false;
+    xd->family_details.gathered   = false;
+    xd->family_details.calculated = false;
   }
 }
 
@@ -279,11 +285,6 @@ namespace {
     return account.self_details().latest_cleared_post;
   }
 
-  template <value_t (*Func)(account_t&)>
-  value_t get_wrapper(call_scope_t& args) {
-    return (*Func)(args.context<account_t>());
-  }
-
   value_t get_parent(account_t& account) {
     return scope_value(account.parent);
   }
@@ -313,6 +314,33 @@ namespace {
     }
     return true;
   }
+
+  // This table must be kept in sorted order.
+  const builtin_t account_builtins[] = {
+    { "N",                  BUILTIN_ACCESSOR(account_t, get_count) },
+    { "O",                  BUILTIN_ACCESSOR(account_t, get_total) },
+    { "a",                  BUILTIN_ACCESSOR(account_t, get_amount) },
+    { "account",            BUILTIN_FUNCTOR(get_account) },
+    { "account_base",       BUILTIN_ACCESSOR(account_t, get_account_base) },
+    { "addr",               BUILTIN_ACCESSOR(account_t, get_addr) },
+    { "all",                BUILTIN_FUNCTOR(fn_all) },
+    { "amount",             BUILTIN_ACCESSOR(account_t, get_amount) },
+    { "any",                BUILTIN_FUNCTOR(fn_any) },
+    { "cost",               BUILTIN_ACCESSOR(account_t, get_cost) },
+    { "count",              BUILTIN_ACCESSOR(account_t, get_count) },
+    { "depth",              BUILTIN_ACCESSOR(account_t, get_depth) },
+    { "depth_spacer",       BUILTIN_ACCESSOR(account_t, get_depth_spacer) },
+    { "is_account",         BUILTIN_ACCESSOR(account_t, get_true) },
+    { "is_index",           BUILTIN_ACCESSOR(account_t, get_subcount) },
+    { "l",                  BUILTIN_ACCESSOR(account_t, get_depth) },
+    { "latest_cleared",     BUILTIN_ACCESSOR(account_t, get_latest_cleared) },
+    { "n",                  BUILTIN_ACCESSOR(account_t, get_subcount) },
+    { "parent",             BUILTIN_ACCESSOR(account_t, get_parent) },
+    { "partial_account",    BUILTIN_FUNCTOR(get_partial_name) },
+    { "subcount",           BUILTIN_ACCESSOR(account_t, get_subcount) },
+    { "total",              BUILTIN_ACCESSOR(account_t, get_total) },
+    { "use_direct_amount",  BUILTIN_ACCESSOR(account_t, ignore) },
+  };
 }
 
 expr_t::ptr_op_t account_t::lookup(const symbol_t::kind_t kind,
@@ -321,89 +349,7 @@ expr_t::ptr_op_t account_t::lookup(const symbol_t::kind_t kind,
   if (kind != symbol_t::FUNCTION)
     return NULL;
 
-  switch (name[0]) {
-  case 'a':
-    if (name[1] == '\0' || name == "amount")
-      return WRAP_FUNCTOR(get_wrapper<&get_amount>);
-    else if (name == "account")
-      return WRAP_FUNCTOR(&get_account);
-    else if (name == "account_base")
-      return WRAP_FUNCTOR(get_wrapper<&get_account_base>);
-    else if (name == "addr")
-      return WRAP_FUNCTOR(get_wrapper<&get_addr>);
-    else if (name == "any")
-      return WRAP_FUNCTOR(&fn_any);
-    else if (name == "all")
-      return WRAP_FUNCTOR(&fn_all);
-    break;
-
-  case 'c':
-    if (name == "count")
-      return WRAP_FUNCTOR(get_wrapper<&get_count>);
-    else if (name == "cost")
-      return WRAP_FUNCTOR(get_wrapper<&get_cost>);
-    break;
-
-  case 'd':
-    if (name == "depth")
-      return WRAP_FUNCTOR(get_wrapper<&get_depth>);
-    else if (name == "depth_spacer")
-      return WRAP_FUNCTOR(get_wrapper<&get_depth_spacer>);
-    break;
-
-  case 'i':
-    if (name == "is_account")
-      return WRAP_FUNCTOR(get_wrapper<&get_true>);
-    else if (name == "is_index")
-      return WRAP_FUNCTOR(get_wrapper<&get_subcount>);
-    break;
-
-  case 'l':
-    if (name == "latest_cleared")
-      return WRAP_FUNCTOR(get_wrapper<&get_latest_cleared>);
-    else if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_depth>);
-    break;
-
-  case 'n':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_subcount>);
-    break;
-
-  case 'p':
-    if (name == "partial_account")
-      return WRAP_FUNCTOR(get_partial_name);
-    else if (name == "parent")
-      return WRAP_FUNCTOR(get_wrapper<&get_parent>);
-    break;
-
-  case 's':
-    if (name == "subcount")
-      return WRAP_FUNCTOR(get_wrapper<&get_subcount>);
-    break;
-
-  case 't':
-    if (name == "total")
-      return WRAP_FUNCTOR(get_wrapper<&get_total>);
-    break;
-
-  case 'u':
-    if (name == "use_direct_amount")
-      return WRAP_FUNCTOR(get_wrapper<&ignore>);
-    break;
-
-  case 'N':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_count>);
-    break;
-
-  case 'O':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_total>);
-    break;
-  }
-
-  return NULL;
+  return lookup_builtin(account_builtins, name);
 }
 
 bool account_t::valid() const
@@ -492,9 +438,22 @@ account_t::xdata_t::details_t::operator+=(const details_t& other)
   return *this;
 }
 
+account_t::xdata_t * account_t::table_xdata(bool create) const
+{
+  xdata_table_t::account_map& accounts(current_xdata_table->accounts);
+  if (create)
+    return &accounts[this];
+
+  xdata_table_t::account_map::iterator i = accounts.find(this);
+  return i != accounts.end() ? &(*i).second : NULL;
+}
+
 void account_t::clear_xdata()
 {
-  xdata_ = none;
+  if (current_xdata_table)
+    current_xdata_table->accounts.erase(this);
+  else
+    xdata_ = none;
 
   foreach (accounts_map::value_type& pair, accounts)
     if (! pair.second->has_flags(ACCOUNT_TEMP))
@@ -503,39 +462,40 @@ void account_t::clear_xdata()
 
 value_t account_t::amount(const optional<expr_t&>& expr) const
 {
-  if (xdata_ && xdata_->has_flags(ACCOUNT_EXT_VISITED)) {
+  xdata_t * xd = find_xdata();
+  if (xd && xd->has_flags(ACCOUNT_EXT_VISITED)) {
     posts_list::const_iterator i;
-    if (xdata_->self_details.last_post)
-      i = *xdata_->self_details.last_post;
+    if (xd->self_details.last_post)
+      i = *xd->self_details.last_post;
     else
       i = posts.begin();
 
     for (; i != posts.end(); i++) {
       if ((*i)->xdata().has_flags(POST_EXT_VISITED)) {
         if (! (*i)->xdata().has_flags(POST_EXT_CONSIDERED)) {
-          (*i)->add_to_value(xdata_->self_details.total, expr);
+          (*i)->add_to_value(xd->self_details.total, expr);
           (*i)->xdata().add_flags(POST_EXT_CONSIDERED);
         }
       }
-      xdata_->self_details.last_post = i;
+      xd->self_details.last_post = i;
     }
 
-    if (xdata_->self_details.last_reported_post)
-      i = *xdata_->self_details.last_reported_post;
+    if (xd->self_details.last_reported_post)
+      i = *xd->self_details.last_reported_post;
     else
-      i = xdata_->reported_posts.begin();
+      i = xd->reported_posts.begin();
 
-    for (; i != xdata_->reported_posts.end(); i++) {
+    for (; i != xd->reported_posts.end(); i++) {
       if ((*i)->xdata().has_flags(POST_EXT_VISITED)) {
         if (! (*i)->xdata().has_flags(POST_EXT_CONSIDERED)) {
-          (*i)->add_to_value(xdata_->self_details.total, expr);
+          (*i)->add_to_value(xd->self_details.total, expr);
           (*i)->xdata().add_flags(POST_EXT_CONSIDERED);
         }
       }
-      xdata_->self_details.last_reported_post = i;
+      xd->self_details.last_reported_post = i;
     }
 
-    return xdata_->self_details.total;
+    return xd->self_details.total;
   } else {
     return NULL_VALUE;
   }
@@ -543,47 +503,50 @@ value_t account_t::amount(const optional<expr_t&>& expr) const
 
 value_t account_t::total(const optional<expr_t&>& expr) const
 {
-  if (! (xdata_ && xdata_->family_details.calculated)) {
-    const_cast<account_t&>(*this).xdata().family_details.calculated = true;
+  xdata_t& xd(const_cast<account_t&>(*this).xdata());
+  if (! xd.family_details.calculated) {
+    xd.family_details.calculated = true;
 
     value_t temp;
     foreach (const accounts_map::value_type& pair, accounts) {
       temp = pair.second->total(expr);
       if (! temp.is_null())
-        add_or_set_value(xdata_->family_details.total, temp);
+        add_or_set_value(xd.family_details.total, temp);
     }
 
     temp = amount(expr);
     if (! temp.is_null())
-      add_or_set_value(xdata_->family_details.total, temp);
+      add_or_set_value(xd.family_details.total, temp);
   }
-  return xdata_->family_details.total;
+  return xd.family_details.total;
 }
 
 const account_t::xdata_t::details_t&
 account_t::self_details(bool gather_all) const
 {
-  if (! (xdata_ && xdata_->self_details.gathered)) {
-    const_cast<account_t&>(*this).xdata().self_details.gathered = true;
+  xdata_t& xd(const_cast<account_t&>(*this).xdata());
+  if (! xd.self_details.gathered) {
+    xd.self_details.gathered = true;
 
     foreach (const post_t * post, posts)
-      xdata_->self_details.update(const_cast<post_t&>(*post), gather_all);
+      xd.self_details.update(const_cast<post_t&>(*post), gather_all);
   }
-  return xdata_->self_details;
+  return xd.self_details;
 }
 
 const account_t::xdata_t::details_t&
 account_t::family_details(bool gather_all) const
 {
-  if (! (xdata_ && xdata_->family_details.gathered)) {
-    const_cast<account_t&>(*this).xdata().family_details.gathered = true;
+  xdata_t& xd(const_cast<account_t&>(*this).xdata());
+  if (! xd.family_details.gathered) {
+    xd.family_details.gathered = true;
 
     foreach (const accounts_map::value_type& pair, accounts)
-      xdata_->family_details += pair.second->family_details(gather_all);
+      xd.family_details += pair.second->family_details(gather_all);
 
-    xdata_->family_details += self_details(gather_all);
+    xd.family_details += self_details(gather_all);
   }
-  return xdata_->family_details;
+  return xd.family_details;
 }
 
 void account_t::xdata_t::details_t::update(post_t& post,
@@ -53,6 +53,13 @@ class post_t;
 typedef std::list<post_t *> posts_list;
 typedef std::map<const string, account_t *> accounts_map;
 
+class xdata_table_t;
+
+// The side table that the extended data of accounts and postings is kept
+// in while a report is bound to one (see xdata.h); NULL to keep it within
+// each object.
+extern xdata_table_t * current_xdata_table;
+
 class account_t : public supports_flags<>, public scope_t
 {
 #define ACCOUNT_NORMAL    0x00  // no flags at all, a basic account
@@ -221,18 +228,28 @@ public:
   // moment.
   mutable optional<xdata_t> xdata_;
 
+  xdata_t * table_xdata(bool create) const;
+
+  xdata_t * find_xdata() const {
+    if (current_xdata_table)
+      return table_xdata(false);
+    return xdata_ ? &*xdata_ : NULL;
+  }
   bool has_xdata() const {
-    return xdata_;
+    return find_xdata() != NULL;
   }
   void clear_xdata();
   xdata_t& xdata() {
+    if (current_xdata_table)
+      return *table_xdata(true);
     if (! xdata_)
       xdata_ = xdata_t();
     return *xdata_;
   }
   const xdata_t& xdata() const {
-    assert(xdata_);
-    return *xdata_;
+    xdata_t * xd = find_xdata();
+    assert(xd);
+    return *xd;
   }
 
   value_t amount(const optional<expr_t&>& expr = none) const;
@@ -242,7 +259,8 @@ public:
   const xdata_t::details_t& family_details(bool gather_all = true) const;
 
   bool has_xflags(xdata_t::flags_t flags) const {
-    return xdata_ && xdata_->has_flags(flags);
+    xdata_t * xd = find_xdata();
+    return xd && xd->has_flags(flags);
   }
   bool children_with_xdata() const;
   std::size_t children_with_flags(xdata_t::flags_t flags) const;
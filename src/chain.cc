@@ -182,11 +182,32 @@ post_handler_ptr chain_post_handlers(post_handler_ptr base_handler,
   if (! for_accounts_report) {
     // sort_posts will sort all the posts it sees, based on the `sort_order'
     // value expression.
+    //
+    // When only the head of the sorted postings will be shown, and nothing
+    // between here and truncate_xacts can add postings or drop them for
+    // reasons not known here, only that much of the sort needs keeping.
+    // The amounts displayed must not depend on the running total, which
+    // is not yet known at this point.
     if (report.HANDLED(sort_)) {
       if (report.HANDLED(sort_xacts_))
         handler.reset(new sort_xacts(handler, report.HANDLER(sort_).str()));
+      else if (report.HANDLED(head_) && ! report.HANDLED(tail_) &&
+               report.HANDLER(head_).value.to_long() > 0 &&
+               ! report.HANDLED(only_) && ! report.HANDLED(display_) &&
+               ! report.HANDLED(revalued) &&
+               (report.HANDLED(empty) ||
+                (report.HANDLER(amount_).str() == "amount" &&
+                 report.HANDLER(display_amount_).str() == "amount_expr")))
+        handler.reset(new sort_head_posts
+                      (handler, report, report.HANDLER(sort_).str(),
+                       static_cast<std::size_t>
+                         (report.HANDLER(head_).value.to_long())));
       else
-        handler.reset(new sort_posts(handler, report.HANDLER(sort_).str()));
+        handler.reset(new sort_posts
+                      (handler, report.HANDLER(sort_).str(),
+                       report.HANDLED(sort_budget_) ?
+                       static_cast<std::size_t>
+                         (report.HANDLER(sort_budget_).value.to_long()) : 0));
     }
 
     // collapse_posts causes xacts with multiple posts to appear as xacts
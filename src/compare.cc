@@ -35,6 +35,7 @@
 #include "op.h"
 #include "post.h"
 #include "account.h"
+#include "commodity.h"
 
 namespace ledger {
 
@@ -70,21 +71,32 @@ bool compare_items<post_t>::operator()(post_t * left, post_t * right)
   assert(left);
   assert(right);
 
-  post_t::xdata_t& lxdata(left->xdata());
-  if (! lxdata.has_flags(POST_EXT_SORT_CALC)) {
-    bind_scope_t bound_scope(*sort_order.get_context(), *left);
-    find_sort_values(lxdata.sort_values, bound_scope);
-    lxdata.add_flags(POST_EXT_SORT_CALC);
-  }
+  return sort_value_is_less_than(sort_values(left), sort_values(right));
+}
 
-  post_t::xdata_t& rxdata(right->xdata());
-  if (! rxdata.has_flags(POST_EXT_SORT_CALC)) {
-    bind_scope_t bound_scope(*sort_order.get_context(), *right);
-    find_sort_values(rxdata.sort_values, bound_scope);
-    rxdata.add_flags(POST_EXT_SORT_CALC);
+template <>
+std::list<sort_value_t>& compare_items<post_t>::sort_values(post_t * post)
+{
+  post_t::xdata_t& xdata(post->xdata());
+  if (! xdata.has_flags(POST_EXT_SORT_CALC)) {
+    bind_scope_t bound_scope(*sort_order.get_context(), *post);
+    find_sort_values(xdata.sort_values, bound_scope);
+    xdata.add_flags(POST_EXT_SORT_CALC);
   }
+  return xdata.sort_values;
+}
 
-  return sort_value_is_less_than(lxdata.sort_values, rxdata.sort_values);
+template <>
+std::list<sort_value_t>&
+compare_items<account_t>::sort_values(account_t * account)
+{
+  account_t::xdata_t& xdata(account->xdata());
+  if (! xdata.has_flags(ACCOUNT_EXT_SORT_CALC)) {
+    bind_scope_t bound_scope(*sort_order.get_context(), *account);
+    find_sort_values(xdata.sort_values, bound_scope);
+    xdata.add_flags(ACCOUNT_EXT_SORT_CALC);
+  }
+  return xdata.sort_values;
 }
 
 template <>
@@ -93,24 +105,254 @@ bool compare_items<account_t>::operator()(account_t * left, account_t * right)
   assert(left);
   assert(right);
 
-  account_t::xdata_t& lxdata(left->xdata());
-  if (! lxdata.has_flags(ACCOUNT_EXT_SORT_CALC)) {
-    bind_scope_t bound_scope(*sort_order.get_context(), *left);
-    find_sort_values(lxdata.sort_values, bound_scope);
-    lxdata.add_flags(ACCOUNT_EXT_SORT_CALC);
+  std::list<sort_value_t>& lvalues(sort_values(left));
+  std::list<sort_value_t>& rvalues(sort_values(right));
+
+  DEBUG("value.sort", "Comparing accounts " << left->fullname()
+        << " <> " << right->fullname());
+
+  return sort_value_is_less_than(lvalues, rvalues);
+}
+
+namespace {
+  typedef std::pair<boost::uint64_t, post_t *> packed_key_t;
+
+  enum key_category_t {
+    KEY_NONE,
+    KEY_DATE,
+    KEY_DATETIME,
+    KEY_NUMBER
+  };
+
+  // Turn a sort value into a double which orders the same way as the
+  // value does.  If two values differ but their keys do not, 'exact' is
+  // cleared.  Values which do not order as plain numbers against the rest
+  // (different commodities, balances, strings, ...) cannot be packed.
+  bool numeric_sort_key(const sort_value_t& sort_value,
+                        key_category_t&     category,
+                        const amount_t *&   commodity_amount,
+                        double&             key,
+                        bool&               exact)
+  {
+    const value_t& value(sort_value.value);
+    key_category_t this_category;
+
+    switch (value.type()) {
+    case value_t::DATE:
+      if (value.as_date().is_special())
+        return false;
+      this_category = KEY_DATE;
+      key = double(value.as_date().day_number());
+      break;
+
+    case value_t::DATETIME:
+      if (value.as_datetime().is_special())
+        return false;
+      this_category = KEY_DATETIME;
+      key = double((value.as_datetime() -
+                    datetime_t(date_t(1970, 1, 1))).total_microseconds());
+      exact = false;
+      break;
+
+    case value_t::INTEGER:
+      this_category = KEY_NUMBER;
+      key = double(value.as_long());
+      if (std::fabs(key) > 4503599627370496.0) // 2^52
+        exact = false;
+      break;
+
+    case value_t::AMOUNT: {
+      const amount_t& amount(value.as_amount());
+      if (amount.is_null())
+        return false;
+      if (amount.has_commodity()) {
+        if (! commodity_amount)
+          commodity_amount = &amount;
+        else if (amount.commodity() != commodity_amount->commodity())
+          return false;
+      }
+      this_category = KEY_NUMBER;
+      key = amount.to_double();
+      exact = false;
+      break;
+    }
+
+    default:
+      return false;
+    }
+
+    if (category == KEY_NONE)
+      category = this_category;
+    else if (category != this_category)
+      return false;
+
+    if (sort_value.inverted)
+      key = - key;
+    if (key == 0.0)
+      key = 0.0;                // so that -0.0 and 0.0 pack the same
+
+    return true;
   }
 
-  account_t::xdata_t& rxdata(right->xdata());
-  if (! rxdata.has_flags(ACCOUNT_EXT_SORT_CALC)) {
-    bind_scope_t bound_scope(*sort_order.get_context(), *right);
-    find_sort_values(rxdata.sort_values, bound_scope);
-    rxdata.add_flags(ACCOUNT_EXT_SORT_CALC);
+  boost::uint64_t pack_key(double key)
+  {
+    const boost::uint64_t sign_bit = boost::uint64_t(1) << 63;
+
+    boost::uint64_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return (bits & sign_bit) ? ~bits : (bits | sign_bit);
   }
 
-  DEBUG("value.sort", "Comparing accounts " << left->fullname()
-        << " <> " << right->fullname());
+  void radix_sort(std::vector<packed_key_t>& keys)
+  {
+    std::vector<packed_key_t> temp(keys.size());
+    std::vector<std::size_t>  counts;
+
+    for (int shift = 0; shift < 64; shift += 16) {
+      counts.assign(0x10001, 0);
+      foreach (const packed_key_t& key, keys)
+        counts[((key.first >> shift) & 0xFFFF) + 1]++;
+
+      // A pass on which every key has the same digit changes nothing.
+      if (counts[((keys.front().first >> shift) & 0xFFFF) + 1] ==
+          keys.size())
+        continue;
+
+      for (std::size_t i = 1; i < counts.size(); i++)
+        counts[i] += counts[i - 1];
+      foreach (const packed_key_t& key, keys)
+        temp[counts[(key.first >> shift) & 0xFFFF]++] = key;
+      keys.swap(temp);
+    }
+  }
+}
+
+void stable_sort_posts(std::deque<post_t *>& posts, const expr_t& sort_order)
+{
+  if (posts.size() < 2)
+    return;
+
+  compare_items<post_t> compare(sort_order);
+
+  std::vector<packed_key_t> keys;
+  keys.reserve(posts.size());
+
+  key_category_t   category         = KEY_NONE;
+  const amount_t * commodity_amount = NULL;
+  bool             exact            = true;
+  bool             packed           = true;
+
+  foreach (post_t * post, posts) {
+    std::list<sort_value_t>& values(compare.sort_values(post));
+
+    double key;
+    if (packed &&
+        (values.size() != 1 ||
+         ! numeric_sort_key(values.front(), category, commodity_amount,
+                            key, exact)))
+      packed = false;
+
+    if (packed)
+      keys.push_back(packed_key_t(pack_key(key), post));
+  }
+
+  if (! packed) {
+    std::stable_sort(posts.begin(), posts.end(), compare);
+    return;
+  }
+
+  radix_sort(keys);
+
+  std::size_t i = 0;
+  foreach (const packed_key_t& key, keys)
+    posts[i++] = key.second;
+
+  // Keys which could not be packed exactly only put postings into the
+  // right runs; within each run, the order is settled by the values
+  // themselves.  Since the radix sort is stable, so is the result.
+  if (! exact) {
+    std::size_t begin = 0;
+    for (std::size_t end = 1; end <= keys.size(); end++) {
+      if (end == keys.size() || keys[end].first != keys[begin].first) {
+        if (end - begin > 1)
+          std::stable_sort(posts.begin() + begin, posts.begin() + end,
+                           compare);
+        begin = end;
+      }
+    }
+  }
+}
+
+namespace {
+  void encode_uint(string& key, boost::uint64_t value, int bytes)
+  {
+    while (bytes-- > 0)
+      key += char((value >> (bytes * 8)) & 0xFF);
+  }
+}
+
+bool encode_sort_key(const std::list<sort_value_t>& sort_values,
+                     string& key, string& types)
+{
+  const boost::uint64_t sign_bit = boost::uint64_t(1) << 63;
+
+  key.clear();
+  types.clear();
+
+  foreach (const sort_value_t& sort_value, sort_values) {
+    const value_t&    value(sort_value.value);
+    string::size_type start = key.length();
+
+    switch (value.type()) {
+    case value_t::BOOLEAN:
+      key += char(value.as_boolean() ? 1 : 0);
+      break;
 
-  return sort_value_is_less_than(lxdata.sort_values, rxdata.sort_values);
+    case value_t::INTEGER:
+      encode_uint(key, boost::uint64_t(value.as_long()) ^ sign_bit, 8);
+      break;
+
+    case value_t::DATE:
+      if (value.as_date().is_special())
+        return false;
+      encode_uint(key, value.as_date().day_number(), 4);
+      break;
+
+    case value_t::DATETIME:
+      if (value.as_datetime().is_special())
+        return false;
+      encode_uint(key, boost::uint64_t
+                  ((value.as_datetime() -
+                    datetime_t(date_t(1970, 1, 1))).total_microseconds())
+                  ^ sign_bit, 8);
+      break;
+
+    case value_t::STRING:
+      // Escaping NUL and ending with a double NUL keeps one string from
+      // being a prefix of another, so the values which follow cannot
+      // disturb the order.
+      foreach (char c, value.as_string()) {
+        key += c;
+        if (c == '\0')
+          key += char(0xFF);
+      }
+      key += '\0';
+      key += '\0';
+      break;
+
+    default:
+      return false;
+    }
+
+    if (sort_value.inverted)
+      for (string::size_type i = start; i < key.length(); i++)
+        key[i] = char(~key[i]);
+
+    types += char('A' + int(value.type()));
+    if (sort_value.inverted)
+      types += '-';
+  }
+  return true;
 }
 
 } // namespace ledger
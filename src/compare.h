@@ -74,6 +74,9 @@ public:
     push_sort_value(sort_values, sort_order.get_op(), scope);
   }
 
+  // Return the item's sort values, calculating them on first use.
+  std::list<sort_value_t>& sort_values(T * item);
+
   bool operator()(T * left, T * right);
 };
 
@@ -83,15 +86,32 @@ template <typename T>
 bool compare_items<T>::operator()(T * left, T * right)
 {
   assert(left); assert(right);
-  return sort_value_is_less_than(find_sort_values(left),
-                                 find_sort_values(right));
+  return sort_value_is_less_than(sort_values(left), sort_values(right));
 }
 
 template <>
-bool compare_items<post_t>::operator()(post_t * left, post_t * right);
+std::list<sort_value_t>& compare_items<post_t>::sort_values(post_t * post);
 template <>
-bool compare_items<account_t>::operator()(account_t * left,
-                                          account_t * right);
+std::list<sort_value_t>&
+compare_items<account_t>::sort_values(account_t * account);
+
+/**
+ * Stably sort postings into exactly the order compare_items<post_t>
+ * would give them.  Each posting's sort key is calculated only once, and
+ * when every posting has a single date or numeric key, the keys are
+ * packed into integers and radix sorted rather than compared as values.
+ */
+void stable_sort_posts(std::deque<post_t *>& posts, const expr_t& sort_order);
+
+/**
+ * Encode a list of sort values as a string of bytes which, compared byte
+ * by byte, sorts the way sort_value_is_less_than sorts the values.  Only
+ * keys encoded from values of the same types compare this way, so the
+ * types are returned in 'types'.  Returns false if some value (such as
+ * an amount or a balance) has no such encoding.
+ */
+bool encode_sort_key(const std::list<sort_value_t>& sort_values,
+                     string& key, string& types);
 
 } // namespace ledger
 
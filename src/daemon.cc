@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2003-2010, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <system.hh>
+
+#include "daemon.h"
+
+namespace ledger {
+
+#ifndef WIN32
+
+namespace {
+  // Writing to a client that has gone away must fail with EPIPE rather
+  // than raise SIGPIPE.  Where send() cannot be told so, as on OS X, the
+  // socket itself is.
+#if defined(MSG_NOSIGNAL)
+  const int send_flags = MSG_NOSIGNAL;
+#else
+  const int send_flags = 0;
+#endif
+
+  void suppress_sigpipe(int fd)
+  {
+#if ! defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)fd;
+#endif
+  }
+
+  sockaddr_un socket_address(const path& socket_path)
+  {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    string name(socket_path.string());
+    if (name.length() >= sizeof(addr.sun_path))
+      throw_(daemon_error, _("Socket path '%1' is too long") << socket_path.string());
+    std::strcpy(addr.sun_path, name.c_str());
+
+    return addr;
+  }
+
+  int connect_socket(const path& socket_path)
+  {
+    sockaddr_un addr(socket_address(socket_path));
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+      throw_(daemon_error, _("Failed to create socket"));
+    suppress_sigpipe(fd);
+
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr),
+                  sizeof(addr)) == -1) {
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  bool write_all(int fd, const char * data, std::size_t len)
+  {
+    while (len > 0) {
+      ssize_t written = ::send(fd, data, len, send_flags);
+      if (written == -1) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      data += written;
+      len  -= written;
+    }
+    return true;
+  }
+
+  bool read_all(int fd, char * data, std::size_t len)
+  {
+    while (len > 0) {
+      ssize_t got = ::read(fd, data, len);
+      if (got == -1 && errno == EINTR)
+        continue;
+      if (got <= 0)
+        return false;
+      data += got;
+      len  -= got;
+    }
+    return true;
+  }
+
+  // How long a client may take to send its whole command-line before it
+  // is dropped, so that one which connects and stalls cannot keep the
+  // daemon from serving anyone else.
+  const int request_timeout = 10;
+
+  bool read_request(int fd, string& request)
+  {
+    std::time_t deadline = std::time(NULL) + request_timeout;
+    char        buf[4096];
+
+    for (;;) {
+      std::time_t now = std::time(NULL);
+      if (now >= deadline)
+        return false;
+
+      pollfd fds[1];
+      fds[0].fd     = fd;
+      fds[0].events = POLLIN;
+
+      int ready = ::poll(fds, 1, static_cast<int>(deadline - now) * 1000);
+      if (ready == -1) {
+        if (errno == EINTR && caught_signal != INTERRUPTED)
+          continue;
+        return false;
+      }
+      if (ready == 0)
+        continue;
+
+      // The client shuts down its end once all arguments are written.
+      ssize_t got = ::read(fd, buf, sizeof(buf));
+      if (got == 0)
+        return true;
+      if (got == -1) {
+        if (errno == EINTR && caught_signal != INTERRUPTED)
+          continue;
+        return false;
+      }
+      request.append(buf, got);
+    }
+  }
+
+  // How long a client may go without taking any of its response before
+  // it is dropped, so that one which stops reading, such as a pager
+  // left open, cannot hold up everyone else either.
+  const int response_timeout = 10;
+
+  bool write_response(int fd, const char * data, std::size_t len)
+  {
+    while (len > 0) {
+      pollfd fds[1];
+      fds[0].fd     = fd;
+      fds[0].events = POLLOUT;
+
+      int ready = ::poll(fds, 1, response_timeout * 1000);
+      if (ready == -1) {
+        if (errno == EINTR && caught_signal != INTERRUPTED)
+          continue;
+        return false;
+      }
+      if (ready == 0)
+        return false;
+
+      ssize_t written = ::send(fd, data, len, send_flags | MSG_DONTWAIT);
+      if (written == -1) {
+        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+          continue;
+        return false;
+      }
+      data += written;
+      len  -= written;
+    }
+    return true;
+  }
+
+  void install_interrupt_handler(int sig)
+  {
+    // accept() must return when the daemon is told to stop, rather
+    // than being restarted as std::signal would arrange.
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = sigint_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(sig, &action, NULL);
+  }
+}
+
+daemon_socket_t::daemon_socket_t(const path& _socket_path)
+  : socket_path(_socket_path), listen_fd(-1)
+{
+  TRACE_CTOR(daemon_socket_t, "const path&");
+
+  if (exists(socket_path)) {
+    int fd = connect_socket(socket_path);
+    if (fd != -1) {
+      ::close(fd);
+      throw_(daemon_error,
+             _("A daemon is already listening on '%1'") << socket_path.string());
+    }
+    remove(socket_path);
+  }
+
+  sockaddr_un addr(socket_address(socket_path));
+
+  listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd == -1)
+    throw_(daemon_error, _("Failed to create socket"));
+
+  // Anyone who can connect can read the journal through the daemon, so
+  // the socket is created for its owner alone, and made so explicitly
+  // before any client can reach it.
+  mode_t old_mask = ::umask(S_IRWXG | S_IRWXO);
+  int    bound    = ::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr),
+                           sizeof(addr));
+  ::umask(old_mask);
+
+  if (bound == -1 ||
+      ::chmod(addr.sun_path, S_IRUSR | S_IWUSR) == -1 ||
+      ::listen(listen_fd, 16) == -1) {
+    ::close(listen_fd);
+    throw_(daemon_error, _("Failed to listen on '%1'") << socket_path.string());
+  }
+
+  install_interrupt_handler(SIGINT);
+  install_interrupt_handler(SIGTERM);
+}
+
+daemon_socket_t::~daemon_socket_t()
+{
+  TRACE_DTOR(daemon_socket_t);
+
+  ::close(listen_fd);
+  remove(socket_path);
+}
+
+int daemon_socket_t::accept_request(strings_list& args, int wake_fd)
+{
+  for (;;) {
+    if (caught_signal == INTERRUPTED)
+      return STOPPED;
+
+    pollfd fds[2];
+    fds[0].fd     = listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = wake_fd;
+    fds[1].events = POLLIN;
+
+    if (::poll(fds, wake_fd == -1 ? 1 : 2, -1) == -1) {
+      if (errno == EINTR)
+        continue;
+      throw_(daemon_error, _("Failed to wait on '%1'")
+             << socket_path.string());
+    }
+    if (wake_fd != -1 && (fds[1].revents & POLLIN))
+      return WOKEN;
+    if (! (fds[0].revents & POLLIN))
+      continue;
+
+    int fd = ::accept(listen_fd, NULL, NULL);
+    if (fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      throw_(daemon_error, _("Failed to accept on '%1'") << socket_path.string());
+    }
+    suppress_sigpipe(fd);
+
+    string request;
+    if (! read_request(fd, request)) {
+      DEBUG("daemon.request", "dropped a client that did not finish");
+      ::close(fd);
+      continue;
+    }
+
+    args.clear();
+    string::size_type beg = 0, end;
+    while ((end = request.find('\0', beg)) != string::npos) {
+      args.push_back(string(request, beg, end - beg));
+      beg = end + 1;
+    }
+    DEBUG("daemon.request", "received " << args.size() << " arguments");
+
+    return fd;
+  }
+}
+
+daemon_response_t::daemon_response_t(int _connection_fd)
+  : connection_fd(_connection_fd), connected(true),
+    out(frame_sink(this, 'o')), err(frame_sink(this, 'e'))
+{
+  TRACE_CTOR(daemon_response_t, "int");
+
+  std::cout.flush();
+  std::cerr.flush();
+  cout_buf = std::cout.rdbuf(out.rdbuf());
+  cerr_buf = std::cerr.rdbuf(err.rdbuf());
+}
+
+daemon_response_t::~daemon_response_t()
+{
+  TRACE_DTOR(daemon_response_t);
+
+  std::cout.rdbuf(cout_buf);
+  std::cerr.rdbuf(cerr_buf);
+  std::cout.clear();
+  std::cerr.clear();
+
+  ::close(connection_fd);
+}
+
+void daemon_response_t::write_frame(char channel, const char * data,
+                                    std::streamsize len)
+{
+  if (! connected)
+    return;
+
+  char header[5];
+  header[0] = channel;
+  header[1] = static_cast<char>((len >> 24) & 0xff);
+  header[2] = static_cast<char>((len >> 16) & 0xff);
+  header[3] = static_cast<char>((len >> 8) & 0xff);
+  header[4] = static_cast<char>(len & 0xff);
+
+  if (! write_response(connection_fd, header, sizeof(header)) ||
+      ! write_response(connection_fd, data, len)) {
+    DEBUG("daemon.request", "dropped a client that stopped reading");
+    connected = false;
+  }
+}
+
+void daemon_response_t::finish(int status)
+{
+  std::cout.flush();
+  std::cerr.flush();
+
+  char code = static_cast<char>(status);
+  write_frame('x', &code, 1);
+}
+
+int forward_to_daemon(const path& socket_path, const strings_list& args)
+{
+  int fd = connect_socket(socket_path);
+  if (fd == -1)
+    throw_(daemon_error, _("No daemon is listening on '%1'") << socket_path.string());
+
+  string request;
+  foreach (const string& arg, args) {
+    request += arg;
+    request += '\0';
+  }
+  if (! write_all(fd, request.data(), request.length())) {
+    ::close(fd);
+    throw_(daemon_error, _("Failed to send command to '%1'") << socket_path.string());
+  }
+  ::shutdown(fd, SHUT_WR);
+
+  int status = -1;
+  char header[5];
+  while (status == -1 && read_all(fd, header, sizeof(header))) {
+    std::size_t len = 0;
+    for (int i = 1; i < 5; i++)
+      len = (len << 8) | static_cast<unsigned char>(header[i]);
+
+    std::vector<char> data(len);
+    if (len > 0 && ! read_all(fd, &data[0], len))
+      break;
+
+    switch (header[0]) {
+    case 'o':
+      std::cout.write(&data[0], len);
+      break;
+    case 'e':
+      std::cout.flush();
+      std::cerr.write(&data[0], len);
+      break;
+    case 'x':
+      if (len == 1)
+        status = static_cast<unsigned char>(data[0]);
+      break;
+    }
+  }
+  ::close(fd);
+  std::cout.flush();
+
+  if (status == -1)
+    throw_(daemon_error,
+           _("Daemon on '%1' closed the connection unexpectedly")
+           << socket_path.string());
+  return status;
+}
+
+#else // WIN32
+
+daemon_socket_t::daemon_socket_t(const path& _socket_path)
+  : socket_path(_socket_path), listen_fd(-1)
+{
+  throw_(daemon_error, _("Daemon mode is not supported on this platform"));
+}
+
+daemon_socket_t::~daemon_socket_t() {}
+
+int daemon_socket_t::accept_request(strings_list&, int)
+{
+  return STOPPED;
+}
+
+daemon_response_t::daemon_response_t(int _connection_fd)
+  : connection_fd(_connection_fd), connected(false),
+    out(frame_sink(this, 'o')), err(frame_sink(this, 'e')),
+    cout_buf(NULL), cerr_buf(NULL) {}
+
+daemon_response_t::~daemon_response_t() {}
+
+void daemon_response_t::write_frame(char, const char *, std::streamsize) {}
+
+void daemon_response_t::finish(int) {}
+
+int forward_to_daemon(const path&, const strings_list&)
+{
+  throw_(daemon_error, _("Daemon mode is not supported on this platform"));
+  return 1;
+}
+
+#endif // WIN32
+
+} // namespace ledger
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2003-2010, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup util
+ */
+
+/**
+ * @file   daemon.h
+ * @author John Wiegley
+ *
+ * @ingroup util
+ *
+ * @brief Serving command-lines to a resident Ledger over a local socket.
+ *
+ * A daemon keeps its parsed journal in memory and listens on a Unix
+ * domain socket.  A client connects, writes its arguments (each one
+ * terminated by a NUL byte) and then shuts down its writing end.  The
+ * daemon answers with a series of frames, each being a channel byte
+ * followed by a four byte, big-endian payload length and the payload:
+ *
+ *   'o'  ; text bound for standard output
+ *   'e'  ; text bound for standard error
+ *   'x'  ; the exit status, as a single byte; always the last frame
+ */
+#ifndef _DAEMON_H
+#define _DAEMON_H
+
+#include "utils.h"
+
+namespace ledger {
+
+DECLARE_EXCEPTION(daemon_error, std::runtime_error);
+
+/**
+ * @brief The listening end of a daemon's socket
+ *
+ * Binding the socket replaces any stale socket file left behind by a
+ * daemon that was killed, but refuses to displace a daemon that is
+ * still answering on it.  Only its owner may connect to the socket,
+ * and the socket file is removed on destruction.
+ */
+class daemon_socket_t : public noncopyable
+{
+  path socket_path;
+  int  listen_fd;
+
+public:
+  enum {
+    STOPPED = -1,
+    WOKEN   = -2
+  };
+
+  explicit daemon_socket_t(const path& _socket_path);
+  ~daemon_socket_t();
+
+  /**
+   * Wait for the next client and read its command-line into args.  A
+   * client that does not finish sending it within a few seconds is
+   * dropped, and the wait goes on.
+   *
+   * @param wake_fd If not -1, stop waiting when this descriptor becomes
+   * readable, such as when a file_watcher_t sees a change.
+   *
+   * @return The connection's descriptor, to be handed to a
+   * daemon_response_t; or STOPPED if the daemon was interrupted, or
+   * WOKEN if wake_fd became readable.
+   */
+  int accept_request(strings_list& args, int wake_fd = -1);
+};
+
+/**
+ * @brief Sends the results of one request back to its client
+ *
+ * While a response exists, std::cout and std::cerr write frames to the
+ * client instead of the daemon's own terminal.  If the client goes
+ * away, or takes none of its output for a few seconds, further output
+ * is silently discarded.
+ */
+class daemon_response_t : public noncopyable
+{
+  struct frame_sink
+  {
+    typedef char                 char_type;
+    typedef iostreams::sink_tag  category;
+
+    daemon_response_t * response;
+    char                channel;
+
+    frame_sink(daemon_response_t * _response, char _channel)
+      : response(_response), channel(_channel) {}
+
+    std::streamsize write(const char * s, std::streamsize n) {
+      response->write_frame(channel, s, n);
+      return n;
+    }
+  };
+
+  int  connection_fd;
+  bool connected;
+
+  iostreams::stream<frame_sink> out;
+  iostreams::stream<frame_sink> err;
+
+  std::streambuf * cout_buf;
+  std::streambuf * cerr_buf;
+
+  void write_frame(char channel, const char * data, std::streamsize len);
+
+public:
+  explicit daemon_response_t(int _connection_fd);
+  ~daemon_response_t();
+
+  /**
+   * Flush any pending output and send the exit status, which ends the
+   * response.
+   */
+  void finish(int status);
+};
+
+/**
+ * Hand a command-line to the daemon listening at socket_path, copying
+ * its response to this process's standard output and error.
+ *
+ * @return The exit status of the command within the daemon.
+ */
+int forward_to_daemon(const path& socket_path, const strings_list& args);
+
+} // namespace ledger
+
+#endif // _DAEMON_H
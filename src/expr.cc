@@ -67,6 +67,16 @@ void expr_t::compile(scope_t& scope)
 {
   if (! compiled && ptr) {
     ptr = ptr->compile(scope);
+
+    shared_ptr<memo_t>         new_memo(new memo_t);
+    std::map<string, ptr_op_t> seen;
+    string                     signature;
+    ptr = ptr->merge_common(new_memo, seen, signature);
+    if (new_memo.use_count() > 1)
+      memo = new_memo;
+    else
+      memo.reset();
+
     base_type::compile(scope);
   }
 }
@@ -75,10 +85,27 @@ value_t expr_t::real_calc(scope_t& scope)
 {
   if (ptr) {
     ptr_op_t locus;
+
+    // Merged subexpressions keep their values only for the duration of
+    // this call.  If the same expression is re-entered while being
+    // calculated, the inner calculation does not use them at all.
+    bool memo_was_active = false;
+    if (memo) {
+      memo_was_active = memo->active;
+      if (! memo_was_active)
+        memo->generation++;
+      memo->active = ! memo_was_active;
+    }
+
     try {
-      return ptr->calc(scope, &locus);
+      value_t result(ptr->calc(scope, &locus));
+      if (memo)
+        memo->active = memo_was_active;
+      return result;
     }
     catch (const std::exception&) {
+      if (memo)
+        memo->active = memo_was_active;
       if (locus) {
         string current_context = error_context();
 
@@ -58,15 +58,26 @@ public:
   typedef intrusive_ptr<op_t>       ptr_op_t;
   typedef intrusive_ptr<const op_t> const_ptr_op_t;
 
+  // Shared by the merged subexpressions of a compiled expression; see
+  // op_t::merge_common.
+  struct memo_t
+  {
+    std::size_t generation;
+    bool        active;
+
+    memo_t() : generation(0), active(false) {}
+  };
+
 protected:
-  ptr_op_t ptr;
+  ptr_op_t           ptr;
+  shared_ptr<memo_t> memo;
 
 public:
   expr_t() : base_type() {
     TRACE_CTOR(expr_t, "");
   }
   expr_t(const expr_t& other)
-    : base_type(other), ptr(other.ptr) {
+    : base_type(other), ptr(other.ptr), memo(other.memo) {
     TRACE_CTOR(expr_t, "copy");
   }
   expr_t(ptr_op_t _ptr, scope_t * _context = NULL)
@@ -93,7 +104,8 @@ public:
   expr_t& operator=(const expr_t& _expr) {
     if (this != &_expr) {
       base_type::operator=(_expr);
-      ptr = _expr.ptr;
+      ptr  = _expr.ptr;
+      memo = _expr.memo;
     }
     return *this;
   }
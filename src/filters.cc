@@ -40,6 +40,8 @@
 
 namespace ledger {
 
+post_t * handed_down_post = NULL;
+
 void post_splitter::print_title(const value_t& val)
 {
   if (! report.HANDLED(no_titles)) {
@@ -151,17 +153,275 @@ void truncate_xacts::operator()(post_t& post)
   posts.push_back(&post);
 }
 
+void sort_posts::operator()(post_t& post)
+{
+  posts.push_back(&post);
+  if (! keyed)
+    return;
+
+  post_t::xdata_t& xdata(post.xdata());
+  string key, types;
+  if (encode_sort_key(compare_items<post_t>(sort_order).sort_values(&post),
+                      key, types) &&
+      (posts.size() == 1 || types == key_types)) {
+    if (posts.size() == 1)
+      key_types = types;
+
+    // Once encoded, the sort values themselves are no longer needed.
+    xdata.sort_values.clear();
+    xdata.drop_flags(POST_EXT_SORT_CALC);
+
+    records_size += key.length() + sizeof(sort_record_t);
+    records.push_back(sort_record_t(key, posts.size() - 1));
+
+    if (records_size > budget)
+      spill_records();
+  } else {
+    DEBUG("filters.sort", "Sort values cannot be encoded, sorting in memory");
+    keyed = false;
+    records.clear();
+    records_size = 0;
+    close_runs();
+  }
+}
+
+namespace {
+  std::FILE * open_sort_run()
+  {
+    std::FILE * run = std::tmpfile();
+    if (! run)
+      throw_(std::runtime_error,
+             _("Could not create a temporary file for sorting"));
+    return run;
+  }
+
+  void write_sort_record(std::FILE * run,
+                         const std::pair<string, std::size_t>& record)
+  {
+    boost::uint32_t length = static_cast<boost::uint32_t>(record.first.length());
+    boost::uint64_t index  = record.second;
+    if (std::fwrite(&length, sizeof(length), 1, run) != 1 ||
+        std::fwrite(record.first.data(), 1, length, run) != length ||
+        std::fwrite(&index, sizeof(index), 1, run) != 1)
+      throw_(std::runtime_error,
+             _("Could not write to a temporary file for sorting"));
+  }
+
+  bool read_sort_record(std::FILE * run, std::pair<string, std::size_t>& record)
+  {
+    boost::uint32_t length;
+    if (std::fread(&length, sizeof(length), 1, run) != 1)
+      return false;
+
+    record.first.resize(length);
+    boost::uint64_t index;
+    if ((length > 0 && std::fread(&record.first[0], 1, length, run) != length) ||
+        std::fread(&index, sizeof(index), 1, run) != 1)
+      throw_(std::runtime_error,
+             _("Could not read from a temporary file for sorting"));
+    record.second = static_cast<std::size_t>(index);
+    return true;
+  }
+}
+
+void sort_posts::spill_records()
+{
+  std::sort(records.begin(), records.end());
+
+  std::FILE * run = open_sort_run();
+  runs.push_back(sort_run_t(run, 0));
+
+  foreach (const sort_record_t& record, records)
+    write_sort_record(run, record);
+  DEBUG("filters.sort", "Spilled a run of " << records.size() << " postings");
+
+  records.clear();
+  records_size = 0;
+
+  // Runs are kept in order of decreasing level, and whenever the last
+  // merge_fan_in of them share a level, they become one run of the next.
+  for (;;) {
+    const std::size_t level = runs.back().second;
+
+    std::size_t count = 0;
+    for (sort_runs_list::reverse_iterator i = runs.rbegin();
+         i != runs.rend() && (*i).second == level; ++i)
+      count++;
+
+    if (count < merge_fan_in)
+      break;
+    merge_tail_runs(count, level + 1);
+  }
+
+  // Every run holds a file open until the merge, so rather than run out
+  // of descriptors, the runs so far are merged into one.  With levels
+  // this only happens after merge_fan_in to the power of the number of
+  // levels spills, which is many more than any budget will need.
+  if (runs.size() >= max_open_runs)
+    merge_tail_runs(runs.size(), runs.front().second + 1);
+}
+
+void sort_posts::merge_tail_runs(const std::size_t count,
+                                 const std::size_t level)
+{
+  sort_runs_list tail;
+  sort_runs_list::iterator first = runs.end();
+  std::advance(first, -static_cast<long>(count));
+  tail.splice(tail.end(), runs, first, runs.end());
+
+  std::FILE * merged = open_sort_run();
+  try {
+    merge_runs(tail, merged);
+  }
+  catch (...) {
+    std::fclose(merged);
+    runs.splice(runs.end(), tail);
+    throw;
+  }
+  close_runs(tail);
+  runs.push_back(sort_run_t(merged, level));
+  DEBUG("filters.sort",
+        "Merged " << count << " runs into one of level " << level);
+}
+
+void sort_posts::merge_runs(sort_runs_list& from, std::FILE * into)
+{
+  typedef std::pair<sort_record_t, std::FILE *> run_head_t;
+
+  std::priority_queue<run_head_t, std::vector<run_head_t>,
+                      std::greater<run_head_t> > heads;
+
+  foreach (sort_run_t& run, from) {
+    std::rewind(run.first);
+    run_head_t head(sort_record_t(), run.first);
+    if (read_sort_record(run.first, head.first))
+      heads.push(head);
+  }
+
+  while (! heads.empty()) {
+    run_head_t head(heads.top());
+    heads.pop();
+
+    if (into)
+      write_sort_record(into, head.first);
+    else
+      item_handler<post_t>::operator()(*posts[head.first.second]);
+
+    if (read_sort_record(head.second, head.first))
+      heads.push(head);
+  }
+}
+
+void sort_posts::close_runs(sort_runs_list& from)
+{
+  foreach (sort_run_t& run, from)
+    std::fclose(run.first);
+  from.clear();
+}
+
 void sort_posts::post_accumulated_posts()
 {
-  std::stable_sort(posts.begin(), posts.end(),
-                   compare_items<post_t>(sort_order));
+  if (keyed) {
+    // Equal keys are ordered by arrival, so the result is stable.
+    if (runs.empty()) {
+      std::sort(records.begin(), records.end());
+      foreach (const sort_record_t& record, records)
+        item_handler<post_t>::operator()(*posts[record.second]);
+    } else {
+      spill_records();
+      merge_runs(runs);
+      close_runs();
+    }
+    records.clear();
+    records_size = 0;
+    key_types.clear();
+  } else {
+    stable_sort_posts(posts, sort_order);
 
-  foreach (post_t * post, posts) {
-    post->xdata().drop_flags(POST_EXT_SORT_CALC);
-    item_handler<post_t>::operator()(*post);
+    foreach (post_t * post, posts) {
+      post->xdata().drop_flags(POST_EXT_SORT_CALC);
+      item_handler<post_t>::operator()(*post);
+    }
   }
 
   posts.clear();
+  keyed = budget > 0;
+}
+
+bool sort_head_posts::compare_ranked_posts::operator()
+  (const ranked_post_t& left, const ranked_post_t& right) const
+{
+  if ((*compare)(left.post, right.post))
+    return true;
+  if ((*compare)(right.post, left.post))
+    return false;
+  return left.sequence < right.sequence;
+}
+
+sort_head_posts::sort_head_posts(post_handler_ptr  handler,
+                                 report_t&         _report,
+                                 const string&     _sort_order,
+                                 const std::size_t _head_count)
+  : item_handler<post_t>(handler), report(_report),
+    display_amount_expr(report.HANDLER(display_amount_).expr),
+    sort_order(_sort_order), compare(sort_order), ranked_order(compare),
+    head_count(_head_count), sequence(0)
+{
+  TRACE_CTOR(sort_head_posts,
+             "post_handler_ptr, report_t&, const string&, std::size_t");
+}
+
+void sort_head_posts::operator()(post_t& post)
+{
+  // Only postings which display_filter_posts will let through can count
+  // toward the transactions truncate_xacts sees.
+  bool displayed = report.HANDLED(empty);
+  if (! displayed) {
+    bind_scope_t bound_scope(report, post);
+    displayed = display_amount_expr.calc(bound_scope);
+  }
+
+  heap.push_back(ranked_post_t(&post, sequence++, displayed));
+  std::push_heap(heap.begin(), heap.end(), ranked_order);
+  if (displayed)
+    xact_counts[post.xact]++;
+
+  // The largest posting can be dropped if the displayed postings before
+  // it belong to head_count transactions other than its own, since
+  // truncate_xacts will have stopped before reaching it.
+  while (heap.size() > 1) {
+    ranked_post_t& largest(heap.front());
+
+    xact_counts_map::iterator i = xact_counts.find(largest.post->xact);
+    std::size_t others = xact_counts.size();
+    if (i != xact_counts.end())
+      others--;
+    if (others < head_count)
+      break;
+
+    if (largest.displayed && --(*i).second == 0)
+      xact_counts.erase(i);
+    largest.post->xdata().drop_flags(POST_EXT_SORT_CALC);
+
+    std::pop_heap(heap.begin(), heap.end(), ranked_order);
+    heap.pop_back();
+  }
+}
+
+void sort_head_posts::flush()
+{
+  std::sort_heap(heap.begin(), heap.end(), ranked_order);
+
+  foreach (ranked_post_t& ranked, heap) {
+    ranked.post->xdata().drop_flags(POST_EXT_SORT_CALC);
+    item_handler<post_t>::operator()(*ranked.post);
+  }
+
+  heap.clear();
+  xact_counts.clear();
+  sequence = 0;
+
+  item_handler<post_t>::flush();
 }
 
 namespace {
@@ -914,9 +1174,66 @@ void interval_posts::report_subtotal(const date_interval_t& interval)
   last_post = NULL;
 }
 
+bool interval_posts::find_period(const date_t& date)
+{
+  // The first period is found by the interval itself, which also aligns
+  // it.  After that, periods are located by binary search among the
+  // boundaries already stepped through, which are extended as needed.
+  if (boundaries.empty() || ! interval.duration) {
+    if (! interval.find_period(date))
+      return false;
+
+    // Later periods step from the start of this one, even when it was
+    // cut short by the beginning of the interval.
+    if (interval.duration) {
+      boundaries.push_back(*interval.start);
+      boundaries.push_back(interval.duration->add(*interval.start));
+      period = 0;
+    }
+    return true;
+  }
+
+  // Just as date_interval_t::find_period, never move back to an earlier
+  // period or beyond the end of the interval.
+  if (interval.finish && date > *interval.finish)
+    return false;
+  if (date < boundaries[period])
+    return false;
+  if (date < *interval.end_of_duration)
+    return true;
+
+  while (boundaries.back() <= date &&
+         (! interval.finish || boundaries.back() < *interval.finish))
+    boundaries.push_back(interval.duration->add(boundaries.back()));
+
+  std::vector<date_t>::iterator i =
+    std::upper_bound(boundaries.begin() + period + 1, boundaries.end(), date);
+  if (i == boundaries.end())
+    return false;
+
+  std::size_t index = static_cast<std::size_t>(i - boundaries.begin()) - 1;
+  if (index == period)
+    return false;
+
+  set_period(interval, index);
+  period = index;
+  return true;
+}
+
+void interval_posts::set_period(date_interval_t& period_interval,
+                                std::size_t      index)
+{
+  period_interval.start           = boundaries[index];
+  period_interval.end_of_duration = boundaries[index + 1];
+  period_interval.next            = none;
+  period_interval.resolve_end();
+}
+
 void interval_posts::operator()(post_t& post)
 {
-  if (! interval.find_period(post.date()))
+  std::size_t last_period = period;
+
+  if (! find_period(post.date()))
     return;
 
   if (interval.duration) {
@@ -924,10 +1241,12 @@ void interval_posts::operator()(post_t& post)
       report_subtotal(last_interval);
 
       if (generate_empty_posts) {
-        for (++last_interval; interval != last_interval; ++last_interval) {
+        for (++last_period; last_period < period; ++last_period) {
           // Generate a null posting, so the intervening periods can be
           // seen when -E is used, or if the calculated amount ends up being
           // non-zero
+          set_period(last_interval, last_period);
+
           xact_t& null_xact = temps.create_xact();
           null_xact._date = last_interval.inclusive_end();
 
@@ -940,13 +1259,9 @@ void interval_posts::operator()(post_t& post)
 
           report_subtotal(last_interval);
         }
-        assert(interval == last_interval);
-      } else {
-        last_interval = interval;
       }
-    } else {
-      last_interval = interval;
     }
+    last_interval = interval;
     subtotal_posts::operator()(post);
   } else {
     item_handler<post_t>::operator()(post);
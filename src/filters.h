@@ -47,6 +47,7 @@
 #include "post.h"
 #include "account.h"
 #include "temps.h"
+#include "compare.h"
 
 namespace ledger {
 
@@ -146,6 +147,14 @@ public:
   }
 };
 
+/**
+ * The posting pass_down_posts is handing down at the moment, or NULL
+ * while the chain is being flushed.  It is the posting named in any
+ * error raised meanwhile, so handlers which format postings later can
+ * record it and report their errors as if they had failed right away.
+ */
+extern post_t * handed_down_post;
+
 template <typename Iterator>
 class pass_down_posts : public item_handler<post_t>
 {
@@ -157,13 +166,21 @@ public:
     TRACE_CTOR(pass_down_posts, "post_handler_ptr, posts_iterator");
 
     while (post_t * post = *iter++) {
+      post_t * outer_post = handed_down_post;
+      handed_down_post = post;
       try {
         item_handler<post_t>::operator()(*post);
       }
       catch (const std::exception&) {
+        handed_down_post = outer_post;
         add_error_context(item_context(*post, _("While handling posting")));
         throw;
       }
+      catch (...) {
+        handed_down_post = outer_post;
+        throw;
+      }
+      handed_down_post = outer_post;
     }
 
     item_handler<post_t>::flush();
@@ -230,26 +247,81 @@ public:
   }
 };
 
+/**
+ * @brief Sort the postings of a report.
+ *
+ * Given a memory budget, sort_posts does an external sort: as postings
+ * arrive, their sort values are encoded into compact keys (see
+ * encode_sort_key), and whenever the keys held in memory exceed the
+ * budget they are sorted and spilled to a temporary file as one run.
+ * The runs are merged when the postings are flushed.  Meanwhile, runs
+ * of the same size are merged a few at a time into larger ones, so
+ * that only a handful of files are ever open at once.  If some
+ * posting's sort values cannot be encoded, it falls back to sorting in
+ * memory.
+ */
 class sort_posts : public item_handler<post_t>
 {
-  typedef std::deque<post_t *> posts_deque;
-
-  posts_deque posts;
-  expr_t      sort_order;
+  typedef std::deque<post_t *>               posts_deque;
+  typedef std::pair<string, std::size_t>     sort_record_t;
+  typedef std::vector<sort_record_t>         sort_records_vector;
+  // A run spilled to a temporary file, and its level: how many merges
+  // its records have been through.
+  typedef std::pair<std::FILE *, std::size_t> sort_run_t;
+  typedef std::list<sort_run_t>               sort_runs_list;
+
+  posts_deque         posts;
+  expr_t              sort_order;
+  std::size_t         budget;
+  bool                keyed;
+  string              key_types;
+  sort_records_vector records;
+  std::size_t         records_size;
+  sort_runs_list      runs;
+
+  // No budget is allowed to be smaller than min_budget bytes, and no more
+  // than max_open_runs temporary files are kept open.  Runs are merged
+  // merge_fan_in at a time, and only with runs of the same level, so
+  // that each record is rewritten once per level rather than once per
+  // merge.
+  static const std::size_t min_budget    = 1024;
+  static const std::size_t max_open_runs = 64;
+  static const std::size_t merge_fan_in  = 8;
 
   sort_posts();
 
-public:
-  sort_posts(post_handler_ptr handler, const expr_t& _sort_order)
-    : item_handler<post_t>(handler), sort_order(_sort_order) {
-    TRACE_CTOR(sort_posts, "post_handler_ptr, const value_expr&");
+  static std::size_t sane_budget(const std::size_t _budget) {
+    if (_budget > 0 && _budget < min_budget)
+      return std::size_t(min_budget);
+    return _budget;
   }
-  sort_posts(post_handler_ptr handler, const string& _sort_order)
-    : item_handler<post_t>(handler), sort_order(_sort_order) {
-    TRACE_CTOR(sort_posts, "post_handler_ptr, const string&");
+
+  void spill_records();
+  void merge_tail_runs(const std::size_t count, const std::size_t level);
+  void merge_runs(sort_runs_list& from, std::FILE * into = NULL);
+  void close_runs() {
+    close_runs(runs);
+  }
+  static void close_runs(sort_runs_list& from);
+
+public:
+  sort_posts(post_handler_ptr  handler,
+             const expr_t&     _sort_order,
+             const std::size_t _budget = 0)
+    : item_handler<post_t>(handler), sort_order(_sort_order),
+      budget(sane_budget(_budget)), keyed(_budget > 0), records_size(0) {
+    TRACE_CTOR(sort_posts, "post_handler_ptr, const value_expr&, std::size_t");
+  }
+  sort_posts(post_handler_ptr  handler,
+             const string&     _sort_order,
+             const std::size_t _budget = 0)
+    : item_handler<post_t>(handler), sort_order(_sort_order),
+      budget(sane_budget(_budget)), keyed(_budget > 0), records_size(0) {
+    TRACE_CTOR(sort_posts, "post_handler_ptr, const string&, std::size_t");
   }
   virtual ~sort_posts() {
     TRACE_DTOR(sort_posts);
+    close_runs();
   }
 
   virtual void post_accumulated_posts();
@@ -259,14 +331,96 @@ public:
     item_handler<post_t>::flush();
   }
 
-  virtual void operator()(post_t& post) {
-    posts.push_back(&post);
-  }
+  virtual void operator()(post_t& post);
 
   virtual void clear() {
     posts.clear();
     sort_order.mark_uncompiled();
 
+    keyed = budget > 0;
+    key_types.clear();
+    records.clear();
+    records_size = 0;
+    close_runs();
+
+    item_handler<post_t>::clear();
+  }
+};
+
+/**
+ * @brief Pass on only as much of a sorted report as --head will show.
+ *
+ * This is sort_posts for the case where truncate_xacts, with a positive
+ * head count, follows it with nothing in between but calc_posts and a
+ * display_filter_posts which does no revaluation.  Rather than sorting
+ * every posting, it keeps a max-heap of the smallest postings seen so
+ * far.  The largest is dropped whenever the postings sorted before it,
+ * and which will be displayed, belong to enough other transactions to
+ * fill the head.  What it passes on always begins with exactly the
+ * postings that sort_posts would have passed on before truncate_xacts
+ * stopped.
+ */
+class sort_head_posts : public item_handler<post_t>
+{
+public:
+  struct ranked_post_t
+  {
+    post_t *    post;
+    std::size_t sequence;
+    bool        displayed;
+
+    ranked_post_t(post_t * _post, std::size_t _sequence, bool _displayed)
+      : post(_post), sequence(_sequence), displayed(_displayed) {}
+  };
+
+  // Orders postings as a stable sort would, by their sort values and
+  // then by the order in which they arrived.  It only points at the
+  // handler's compare_items, so the heap algorithms may copy it freely.
+  struct compare_ranked_posts
+  {
+    compare_items<post_t> * compare;
+
+    explicit compare_ranked_posts(compare_items<post_t>& _compare)
+      : compare(&_compare) {}
+
+    bool operator()(const ranked_post_t& left,
+                    const ranked_post_t& right) const;
+  };
+
+  typedef std::map<xact_t *, std::size_t> xact_counts_map;
+
+protected:
+  report_t&                  report;
+  expr_t&                    display_amount_expr;
+  expr_t                     sort_order;
+  compare_items<post_t>      compare;
+  compare_ranked_posts       ranked_order;
+  std::size_t                head_count;
+  std::size_t                sequence;
+  std::vector<ranked_post_t> heap;
+  xact_counts_map            xact_counts;
+
+  sort_head_posts();
+
+public:
+  sort_head_posts(post_handler_ptr  handler,
+                  report_t&         _report,
+                  const string&     _sort_order,
+                  const std::size_t _head_count);
+  virtual ~sort_head_posts() {
+    TRACE_DTOR(sort_head_posts);
+  }
+
+  virtual void flush();
+  virtual void operator()(post_t& post);
+
+  virtual void clear() {
+    heap.clear();
+    xact_counts.clear();
+    sequence = 0;
+    sort_order.mark_uncompiled();
+    compare = compare_items<post_t>(sort_order);
+
     item_handler<post_t>::clear();
   }
 };
@@ -317,8 +471,8 @@ public:
 
 class filter_posts : public item_handler<post_t>
 {
-  predicate_t pred;
-  scope_t&    context;
+  post_predicate_t pred;
+  scope_t&         context;
 
   filter_posts();
 
@@ -420,8 +574,8 @@ public:
 class collapse_posts : public item_handler<post_t>
 {
   expr_t&             amount_expr;
-  predicate_t         display_predicate;
-  predicate_t         only_predicate;
+  post_predicate_t    display_predicate;
+  post_predicate_t    only_predicate;
   value_t             subtotal;
   std::size_t         count;
   xact_t *            last_xact;
@@ -703,8 +857,16 @@ class interval_posts : public subtotal_posts
   bool            exact_periods;
   bool            generate_empty_posts;
 
+  // The start of each period reached so far, in order, followed by the end
+  // of the last one; `period' indexes the start of the current period.
+  std::vector<date_t> boundaries;
+  std::size_t         period;
+
   interval_posts();
 
+  bool find_period(const date_t& date);
+  void set_period(date_interval_t& period_interval, std::size_t index);
+
 public:
 
   interval_posts(post_handler_ptr       _handler,
@@ -715,7 +877,7 @@ public:
     : subtotal_posts(_handler, amount_expr), start_interval(_interval),
       interval(start_interval), last_post(NULL),
       exact_periods(_exact_periods),
-      generate_empty_posts(_generate_empty_posts) {
+      generate_empty_posts(_generate_empty_posts), period(0) {
     TRACE_CTOR(interval_posts,
                "post_handler_ptr, expr_t&, date_interval_t, bool, bool");
     create_accounts();
@@ -743,6 +905,8 @@ public:
     interval = start_interval;
     last_interval = date_interval_t();
     last_post = NULL;
+    boundaries.clear();
+    period = 0;
 
     subtotal_posts::clear();
     create_accounts();
@@ -948,7 +1112,7 @@ public:
 
 class forecast_posts : public generate_posts
 {
-  predicate_t       pred;
+  post_predicate_t  pred;
   scope_t&          context;
   const std::size_t forecast_years;
 
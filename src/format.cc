@@ -321,22 +321,21 @@ format_t::element_t * format_t::parse_elements(const string& fmt,
 
 string format_t::real_calc(scope_t& scope)
 {
-  std::ostringstream out_str;
+  // Every element is rendered straight into this one buffer, and padded
+  // there to its width by its length in characters, on the left if it is
+  // right-aligned.  A stream is only used for values other than strings
+  // which must be printed to a minimum width, since only value_t::print
+  // knows how to lay those out, and the text is only decoded from UTF-8
+  // if it must be truncated.
+  string out_str;
+  string text;
 
   for (element_t * elem = elements.get(); elem; elem = elem->next.get()) {
-    std::ostringstream out;
-    string name;
-
-    if (elem->has_flags(ELEMENT_ALIGN_LEFT))
-      out << std::left;
-    else
-      out << std::right;
+    const bool align_left = elem->has_flags(ELEMENT_ALIGN_LEFT);
 
     switch (elem->type) {
     case element_t::STRING:
-      if (elem->min_width > 0)
-        out.width(elem->min_width);
-      out << boost::get<string>(elem->data);
+      text = boost::get<string>(elem->data);
       break;
 
     case element_t::EXPR: {
@@ -355,11 +354,22 @@ string format_t::real_calc(scope_t& scope)
         }
         DEBUG("format.expr", "value = (" << value << ")");
 
-        if (elem->min_width > 0)
+        if (value.is_string() &&
+            (elem->max_width == 0 || elem->max_width >= elem->min_width)) {
+          text = value.as_string();
+        }
+        else if (elem->min_width > 0) {
+          std::ostringstream out;
+          if (align_left)
+            out << std::left;
+          else
+            out << std::right;
           value.print(out, static_cast<int>(elem->min_width), -1,
-                      ! elem->has_flags(ELEMENT_ALIGN_LEFT));
-        else
-          out << value.to_string();
+                      ! align_left);
+          text = out.str();
+        } else {
+          text = value.to_string();
+        }
       }
       catch (const calc_error&) {
         string current_context = error_context();
@@ -380,24 +390,23 @@ string format_t::real_calc(scope_t& scope)
     }
 
     if (elem->max_width > 0 || elem->min_width > 0) {
-      unistring temp(out.str());
-      string    result;
+      std::size_t length = unicode_length(text);
 
-      if (elem->max_width > 0 && elem->max_width < temp.length()) {
-        result = truncate(temp, elem->max_width);
+      if (elem->max_width > 0 && elem->max_width < length) {
+        out_str += truncate(unistring(text), elem->max_width);
       } else {
-        result = temp.extract();
-        if (elem->min_width > temp.length())
-          for (std::size_t i = 0; i < elem->min_width - temp.length(); i++)
-            result += " ";
+        if (elem->min_width > length && ! align_left)
+          out_str.append(elem->min_width - length, ' ');
+        out_str += text;
+        if (elem->min_width > length && align_left)
+          out_str.append(elem->min_width - length, ' ');
       }
-      out_str << result;
     } else {
-      out_str << out.str();
+      out_str += text;
     }
   }
 
-  return out_str.str();
+  return out_str;
 }
 
 string format_t::truncate(const unistring&  ustr,
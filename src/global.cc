@@ -37,6 +37,7 @@
 #else
 #include "session.h"
 #endif
+#include "daemon.h"
 #include "item.h"
 #include "journal.h"
 #include "pool.h"
@@ -195,6 +196,8 @@ void global_scope_t::execute_command(strings_list args, bool at_repl)
   if (! is_precommand) {
     if (! at_repl)
       session().read_journal_files();
+    else
+      session().refresh_journal_files();
 
     report().normalize_options(verb);
 
@@ -255,6 +258,60 @@ int global_scope_t::execute_command_wrapper(strings_list args, bool at_repl)
   return status;
 }
 
+void global_scope_t::serve_requests(const path& socket_path)
+{
+  session().resident = true;
+  session().read_journal_files();
+  session().watch_journal_files();
+
+  // The daemon's own terminal is not the client's, so never start a
+  // pager on its behalf.
+  report().HANDLER(pager_).off();
+
+  daemon_socket_t listener(socket_path);
+
+  for (;;) {
+    strings_list args;
+    int fd = listener.accept_request(args,
+                                     session().watcher->descriptor());
+    if (fd == daemon_socket_t::STOPPED)
+      break;
+
+    if (fd == daemon_socket_t::WOKEN) {
+      // A journal file was saved: catch up now, rather than making the
+      // next client wait for it.
+      try {
+        session().refresh_journal_files();
+      }
+      catch (const std::exception& err) {
+        report_error(err);
+      }
+      continue;
+    }
+
+    daemon_response_t response(fd);
+
+    if (! args.empty() && args.front() == "quit") {
+      response.finish(0);
+      break;
+    }
+
+    std::size_t depth  = report_stack.size();
+    int         status = 1;
+    try {
+      status = execute_command_wrapper(args, true);
+    }
+    catch (int _status) {
+      status = _status;         // --version and the help options exit
+    }                           // straight out of option processing
+
+    while (report_stack.size() > depth)
+      pop_report();
+
+    response.finish(status);
+  }
+}
+
 void global_scope_t::report_options(report_t& report, std::ostream& out)
 {
   out << "==============================================================================="
@@ -262,6 +319,7 @@ void global_scope_t::report_options(report_t& report, std::ostream& out)
   out << "[Global scope options]" << std::endl;
 
   HANDLER(args_only).report(out);
+  HANDLER(daemon_).report(out);
   HANDLER(debug_).report(out);
   HANDLER(init_file_).report(out);
   HANDLER(script_).report(out);
@@ -284,8 +342,12 @@ option_t<global_scope_t> * global_scope_t::lookup_option(const char * p)
   case 'a':
     OPT(args_only);
     break;
+  case 'c':
+    OPT(client_);
+    break;
   case 'd':
-    OPT(debug_);
+    OPT(daemon_);
+    else OPT(debug_);
     break;
   case 'f':
     OPT(full_help);
@@ -483,4 +545,31 @@ void handle_debug_options(int argc, char * argv[])
   }
 }
 
+optional<int> handle_client_option(int argc, char * argv[])
+{
+  optional<path> socket_path;
+  strings_list   args;
+
+  for (int i = 1; i < argc; i++) {
+    if (! socket_path && i + 1 < argc &&
+        std::strcmp(argv[i], "--client") == 0)
+      socket_path = path(argv[++i]);
+    else if (! socket_path && std::strncmp(argv[i], "--client=", 9) == 0)
+      socket_path = path(argv[i] + 9);
+    else
+      args.push_back(argv[i]);
+  }
+  if (! socket_path)
+    return none;
+
+  // Whether to color the output depends on where it is going, which only
+  // the client knows.  Options may follow the verb, so this is appended
+  // to leave the verb where the daemon expects to find "quit".
+#ifdef HAVE_ISATTY
+  args.push_back(isatty(STDOUT_FILENO) ? "--force-color" : "--no-color");
+#endif
+
+  return forward_to_daemon(*socket_path, args);
+}
+
 } // namespace ledger
@@ -96,6 +96,13 @@ public:
   void execute_command(strings_list args, bool at_repl);
   int  execute_command_wrapper(strings_list args, bool at_repl);
 
+  /**
+   * Answer command-lines sent by clients over the given socket, each
+   * being run against the journal already in memory, until a client
+   * sends "quit" or the daemon is interrupted.
+   */
+  void serve_requests(const path& socket_path);
+
   value_t push_command(call_scope_t&) {
     // Make a copy at position 2, because the topmost report object has an
     // open output stream at this point.  We want it to get popped off as
@@ -127,6 +134,8 @@ See LICENSE file included with the distribution for details and disclaimer.");
                                   const string& name);
 
   OPTION(global_scope_t, args_only);
+  OPTION(global_scope_t, client_);
+  OPTION(global_scope_t, daemon_);
   OPTION(global_scope_t, debug_);
 
   void visit_man_page() const;
@@ -161,6 +170,14 @@ See LICENSE file included with the distribution for details and disclaimer.");
 
 void handle_debug_options(int argc, char * argv[]);
 
+/**
+ * If the command-line contains --client SOCKET, forward the rest of it
+ * to the daemon listening there.
+ *
+ * @return The daemon's exit status, or none if this is not a client.
+ */
+optional<int> handle_client_option(int argc, char * argv[]);
+
 } // namespace ledger
 
 #endif // _GLOBAL_H
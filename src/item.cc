@@ -352,11 +352,6 @@ namespace {
   value_t ignore(item_t&) {
     return false;
   }
-
-  template <value_t (*Func)(item_t&)>
-  value_t get_wrapper(call_scope_t& scope) {
-    return (*Func)(find_scope<item_t>(scope));
-  }
 }
 
 value_t get_comment(item_t& item)
@@ -386,125 +381,48 @@ value_t get_comment(item_t& item)
   }
 }
 
+namespace {
+  // This table must be kept in sorted order.
+  const builtin_t item_builtins[] = {
+    { "L",               BUILTIN_ACCESSOR(item_t, get_actual) },
+    { "X",               BUILTIN_ACCESSOR(item_t, get_cleared) },
+    { "Y",               BUILTIN_ACCESSOR(item_t, get_pending) },
+    { "actual",          BUILTIN_ACCESSOR(item_t, get_actual) },
+    { "actual_date",     BUILTIN_ACCESSOR(item_t, get_actual_date) },
+    { "addr",            BUILTIN_ACCESSOR(item_t, get_addr) },
+    { "beg_line",        BUILTIN_ACCESSOR(item_t, get_beg_line) },
+    { "beg_pos",         BUILTIN_ACCESSOR(item_t, get_beg_pos) },
+    { "cleared",         BUILTIN_ACCESSOR(item_t, get_cleared) },
+    { "comment",         BUILTIN_ACCESSOR(item_t, get_comment) },
+    { "d",               BUILTIN_ACCESSOR(item_t, get_date) },
+    { "date",            BUILTIN_ACCESSOR(item_t, get_date) },
+    { "depth",           BUILTIN_ACCESSOR(item_t, get_depth) },
+    { "effective_date",  BUILTIN_ACCESSOR(item_t, get_effective_date) },
+    { "end_line",        BUILTIN_ACCESSOR(item_t, get_end_line) },
+    { "end_pos",         BUILTIN_ACCESSOR(item_t, get_end_pos) },
+    { "filename",        BUILTIN_ACCESSOR(item_t, get_pathname) },
+    { "has_meta",        BUILTIN_FUNCTOR(ledger::has_tag) },
+    { "has_tag",         BUILTIN_FUNCTOR(ledger::has_tag) },
+    { "is_account",      BUILTIN_ACCESSOR(item_t, ignore) },
+    { "meta",            BUILTIN_FUNCTOR(ledger::get_tag) },
+    { "note",            BUILTIN_ACCESSOR(item_t, get_note) },
+    { "parent",          BUILTIN_ACCESSOR(item_t, ignore) },
+    { "pending",         BUILTIN_ACCESSOR(item_t, get_pending) },
+    { "seq",             BUILTIN_ACCESSOR(item_t, get_seq) },
+    { "status",          BUILTIN_ACCESSOR(item_t, get_status) },
+    { "tag",             BUILTIN_FUNCTOR(ledger::get_tag) },
+    { "uncleared",       BUILTIN_ACCESSOR(item_t, get_uncleared) },
+    { "value_date",      BUILTIN_ACCESSOR(item_t, get_date) },
+  };
+}
+
 expr_t::ptr_op_t item_t::lookup(const symbol_t::kind_t kind,
                                 const string& name)
 {
   if (kind != symbol_t::FUNCTION)
     return NULL;
 
-  switch (name[0]) {
-  case 'a':
-    if (name == "actual")
-      return WRAP_FUNCTOR(get_wrapper<&get_actual>);
-    else if (name == "actual_date")
-      return WRAP_FUNCTOR(get_wrapper<&get_actual_date>);
-    else if (name == "addr")
-      return WRAP_FUNCTOR(get_wrapper<&get_addr>);
-    break;
-
-  case 'b':
-    if (name == "beg_line")
-      return WRAP_FUNCTOR(get_wrapper<&get_beg_line>);
-    else if (name == "beg_pos")
-      return WRAP_FUNCTOR(get_wrapper<&get_beg_pos>);
-    break;
-
-  case 'c':
-    if (name == "cleared")
-      return WRAP_FUNCTOR(get_wrapper<&get_cleared>);
-    else if (name == "comment")
-      return WRAP_FUNCTOR(get_wrapper<&get_comment>);
-    break;
-
-  case 'd':
-    if (name[1] == '\0' || name == "date")
-      return WRAP_FUNCTOR(get_wrapper<&get_date>);
-    else if (name == "depth")
-      return WRAP_FUNCTOR(get_wrapper<&get_depth>);
-    break;
-
-  case 'e':
-    if (name == "end_line")
-      return WRAP_FUNCTOR(get_wrapper<&get_end_line>);
-    else if (name == "end_pos")
-      return WRAP_FUNCTOR(get_wrapper<&get_end_pos>);
-    else if (name == "effective_date")
-      return WRAP_FUNCTOR(get_wrapper<&get_effective_date>);
-    break;
-
-  case 'f':
-    if (name == "filename")
-      return WRAP_FUNCTOR(get_wrapper<&get_pathname>);
-    break;
-
-  case 'h':
-    if (name == "has_tag")
-      return WRAP_FUNCTOR(ledger::has_tag);
-    else if (name == "has_meta")
-      return WRAP_FUNCTOR(ledger::has_tag);
-    break;
-
-  case 'i':
-    if (name == "is_account")
-      return WRAP_FUNCTOR(get_wrapper<&ignore>);
-    break;
-
-  case 'm':
-    if (name == "meta")
-      return WRAP_FUNCTOR(ledger::get_tag);
-    break;
-
-  case 'n':
-    if (name == "note")
-      return WRAP_FUNCTOR(get_wrapper<&get_note>);
-    break;
-
-  case 'p':
-    if (name == "pending")
-      return WRAP_FUNCTOR(get_wrapper<&get_pending>);
-    else if (name == "parent")
-      return WRAP_FUNCTOR(get_wrapper<&ignore>);
-    break;
-
-  case 's':
-    if (name == "status")
-      return WRAP_FUNCTOR(get_wrapper<&get_status>);
-    else if (name == "seq")
-      return WRAP_FUNCTOR(get_wrapper<&get_seq>);
-    break;
-
-  case 't':
-    if (name == "tag")
-      return WRAP_FUNCTOR(ledger::get_tag);
-    break;
-
-  case 'u':
-    if (name == "uncleared")
-      return WRAP_FUNCTOR(get_wrapper<&get_uncleared>);
-    break;
-
-  case 'v':
-    if (name == "value_date")
-      return WRAP_FUNCTOR(get_wrapper<&get_date>);
-    break;
-
-  case 'L':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_actual>);
-    break;
-
-  case 'X':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_cleared>);
-    break;
-
-  case 'Y':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_pending>);
-    break;
-  }
-
-  return NULL;
+  return lookup_builtin(item_builtins, name);
 }
 
 bool item_t::valid() const
@@ -111,6 +111,40 @@ public:
   }
 };
 
+class posts_list_iterator
+  : public iterator_facade_base<posts_list_iterator, post_t *,
+                                boost::forward_traversal_tag>
+{
+  posts_list::iterator posts_i;
+  posts_list::iterator posts_end;
+
+  bool posts_uninitialized;
+
+public:
+  posts_list_iterator() : posts_uninitialized(true) {}
+  posts_list_iterator(posts_list& posts)
+    : posts_uninitialized(true) {
+    reset(posts);
+  }
+  ~posts_list_iterator() throw() {}
+
+  void reset(posts_list& posts) {
+    posts_i   = posts.begin();
+    posts_end = posts.end();
+
+    posts_uninitialized = false;
+
+    increment();
+  }
+
+  void increment() {
+    if (posts_uninitialized || posts_i == posts_end)
+      m_node = NULL;
+    else
+      m_node = *posts_i++;
+  }
+};
+
 class xacts_iterator
   : public iterator_facade_base<xacts_iterator, xact_t *,
                                 boost::forward_traversal_tag>
@@ -36,7 +36,9 @@
 #include "commodity.h"
 #include "pool.h"
 #include "xact.h"
+#include "post.h"
 #include "account.h"
+#include "xdata.h"
 
 namespace ledger {
 
@@ -75,6 +77,8 @@ journal_t::~journal_t()
   foreach (period_xact_t * xact, period_xacts)
     checked_delete(xact);
 
+  clear_rollups();
+
   checked_delete(master);
 }
 
@@ -83,6 +87,17 @@ void journal_t::initialize()
   master     = new account_t;
   bucket     = NULL;
   was_loaded = false;
+
+  indexed_xacts      = 0;
+  indexed_effective  = false;
+  posts_indexed      = false;
+  posts_rolled_up    = false;
+
+  for (int i = 0; i < POST_INDEXES; i++)
+    keys_indexed[i] = false;
+  posts_checkpointed = false;
+
+  reading_extent = NULL;
 }
 
 void journal_t::add_account(account_t * acct)
@@ -116,6 +131,7 @@ bool journal_t::add_xact(xact_t * xact)
 
   extend_xact(xact);
   xacts.push_back(xact);
+  posts_indexed = false;
 
   return true;
 }
@@ -140,10 +156,370 @@ bool journal_t::remove_xact(xact_t * xact)
 
   xacts.erase(i);
   xact->journal = NULL;
+  posts_indexed = false;
 
   return true;
 }
 
+namespace {
+  bool dated_post_before(const journal_t::dated_post_t& entry,
+                         const date_t& date) {
+    return entry.date < date;
+  }
+
+  void index_key(journal_t::post_index_map& index, const string& key,
+                 std::size_t sequence)
+  {
+    journal_t::post_sequences_t& sequences(index[key]);
+    if (sequences.empty() || sequences.back() != sequence)
+      sequences.push_back(sequence);
+  }
+
+  void index_tags(journal_t::post_index_map& index, const item_t& item,
+                  std::size_t sequence)
+  {
+    if (item.metadata) {
+      foreach (const item_t::string_map::value_type& data, *item.metadata)
+        index_key(index, data.first, sequence);
+    }
+  }
+}
+
+void journal_t::index_posts()
+{
+  // Date keys come from post_t::date(), which is exactly what a "date"
+  // term in a predicate compares against, so the indexes must be rebuilt
+  // if the choice of effective dates changes between reports.
+  if (posts_indexed && indexed_xacts == xacts.size() &&
+      indexed_effective == item_t::use_effective_date)
+    return;
+
+  indexed_posts.clear();
+  dated_posts.clear();
+  clear_rollups();
+  for (int i = 0; i < POST_INDEXES; i++) {
+    post_indexes[i].clear();
+    keys_indexed[i] = false;
+  }
+
+  foreach (xact_t * xact, xacts) {
+    foreach (post_t * post, xact->posts) {
+      dated_post_t entry;
+      entry.date     = post->date();
+      entry.sequence = indexed_posts.size();
+      dated_posts.push_back(entry);
+
+      indexed_posts.push_back(post);
+    }
+  }
+  std::sort(dated_posts.begin(), dated_posts.end());
+
+  indexed_xacts     = xacts.size();
+  indexed_effective = item_t::use_effective_date;
+  posts_indexed     = true;
+}
+
+void journal_t::index_keys(const post_index_t index)
+{
+  index_posts();
+  if (keys_indexed[index])
+    return;
+
+  post_index_map& keys(post_indexes[index]);
+
+  // Keys mirror what the "payee", "code" and "commodity" values and
+  // has_tag() report for a posting, including what it inherits.
+  std::size_t sequence = 0;
+  foreach (post_t * post, indexed_posts) {
+    switch (index) {
+    case PAYEE_INDEX:
+      index_key(keys, post->payee(), sequence);
+      break;
+    case CODE_INDEX:
+      index_key(keys, post->xact->code ? *post->xact->code : empty_string,
+                sequence);
+      break;
+    case COMMODITY_INDEX:
+      index_key(keys, post->amount.commodity().symbol(), sequence);
+      break;
+    case TAG_INDEX:
+      index_tags(keys, *post, sequence);
+      index_tags(keys, *post->xact, sequence);
+      break;
+    default:
+      assert(false);
+      break;
+    }
+    sequence++;
+  }
+
+  keys_indexed[index] = true;
+}
+
+void journal_t::posts_by_date(const optional<date_t>& begin,
+                              const optional<date_t>& end,
+                              post_sequences_t&       sequences)
+{
+  index_posts();
+
+  std::vector<dated_post_t>::const_iterator first = dated_posts.begin();
+  std::vector<dated_post_t>::const_iterator last  = dated_posts.end();
+  if (begin)
+    first = std::lower_bound(first, last, *begin, dated_post_before);
+  if (end)
+    last = std::lower_bound(first, last, *end, dated_post_before);
+
+  for (; first != last; ++first)
+    sequences.push_back((*first).sequence);
+  std::sort(sequences.begin(), sequences.end());
+}
+
+void journal_t::posts_by_key(const post_index_t index, const string& key,
+                             post_sequences_t& sequences)
+{
+  index_keys(index);
+
+  post_index_map::const_iterator i = post_indexes[index].find(key);
+  if (i != post_indexes[index].end())
+    sequences = (*i).second;
+}
+
+void journal_t::posts_by_key(const post_index_t index, const mask_t& mask,
+                             post_sequences_t& sequences)
+{
+  index_keys(index);
+
+  // There are far fewer distinct keys than postings, so the mask is only
+  // run once per key, and the matching lists are merged afterward.
+  std::size_t matches = 0;
+  foreach (const post_index_map::value_type& pair, post_indexes[index]) {
+    if (mask.match(pair.first)) {
+      sequences.insert(sequences.end(),
+                       pair.second.begin(), pair.second.end());
+      matches++;
+    }
+  }
+  if (matches > 1) {
+    std::sort(sequences.begin(), sequences.end());
+    sequences.erase(std::unique(sequences.begin(), sequences.end()),
+                    sequences.end());
+  }
+}
+
+void journal_t::posts_by_sequence(const post_sequences_t& sequences,
+                                  posts_list&             posts)
+{
+  foreach (std::size_t sequence, sequences)
+    posts.push_back(indexed_posts[sequence]);
+}
+
+namespace {
+  struct rollup_key_t
+  {
+    account_t *   account;
+    int           kind;
+    commodity_t * commodity;
+
+    rollup_key_t(const post_t& post)
+      : account(post.account),
+        kind(! post.has_flags(POST_VIRTUAL) ? 0 :
+             post.has_flags(POST_MUST_BALANCE) ? 1 : 2),
+        commodity(post.amount.is_null() ? NULL : &post.amount.commodity()) {}
+
+    bool operator<(const rollup_key_t& other) const {
+      if (account != other.account)
+        return account < other.account;
+      if (kind != other.kind)
+        return kind < other.kind;
+      return commodity < other.commodity;
+    }
+  };
+
+  bool rollup_before(const post_t * post, const date_t& date) {
+    return *post->_date < date;
+  }
+
+  // A generated posting standing in for others of the same kind, posted
+  // to the same account in the same commodity.
+  post_t * rollup_post(xact_t& xact, const post_t& post)
+  {
+    post_t * rollup = new post_t(post.account);
+    rollup->add_flags(ITEM_TEMP | POST_CALCULATED);
+    if (post.has_flags(POST_VIRTUAL))
+      rollup->add_flags(POST_VIRTUAL);
+    if (post.has_flags(POST_MUST_BALANCE))
+      rollup->add_flags(POST_MUST_BALANCE);
+    rollup->_date  = xact._date;
+    rollup->amount = post.amount;
+    xact.add_post(rollup);
+    return rollup;
+  }
+
+  xact_t * rollup_xact(const date_t& date)
+  {
+    xact_t * xact = new xact_t;
+    xact->add_flags(ITEM_TEMP);
+    xact->_date = date;
+    return xact;
+  }
+}
+
+void journal_t::roll_up_posts()
+{
+  index_posts();
+  if (posts_rolled_up)
+    return;
+
+  // Walk the postings by date, so that each day's rollups are made from
+  // one run of dated_posts, in the order the postings appear within it.
+  std::vector<dated_post_t>::const_iterator i = dated_posts.begin();
+  while (i != dated_posts.end()) {
+    date_t   date = (*i).date;
+    xact_t * xact = rollup_xact(date);
+    rollup_xacts.push_back(xact);
+
+    std::map<rollup_key_t, post_t *> day_rollups;
+
+    for (; i != dated_posts.end() && (*i).date == date; ++i) {
+      post_t *     post = indexed_posts[(*i).sequence];
+      rollup_key_t key(*post);
+
+      std::map<rollup_key_t, post_t *>::iterator found =
+        day_rollups.find(key);
+      if (found == day_rollups.end()) {
+        post_t * rollup = rollup_post(*xact, *post);
+        rollups.push_back(rollup);
+        day_rollups.insert
+          (std::pair<rollup_key_t, post_t *>(key, rollup));
+      }
+      else if (key.commodity) {
+        (*found).second->amount += post->amount;
+      }
+    }
+  }
+
+  posts_rolled_up = true;
+}
+
+void journal_t::rollups_by_date(const optional<date_t>& begin,
+                                const optional<date_t>& end,
+                                posts_list&             posts)
+{
+  roll_up_posts();
+
+  std::vector<post_t *>::const_iterator first = rollups.begin();
+  std::vector<post_t *>::const_iterator last  = rollups.end();
+  if (begin)
+    first = std::lower_bound(first, last, *begin, rollup_before);
+  if (end)
+    last = std::lower_bound(first, last, *end, rollup_before);
+
+  posts.insert(posts.end(), first, last);
+}
+
+namespace {
+  bool before_checkpoint(const date_t& date,
+                         const journal_t::checkpoint_t& checkpoint) {
+    return date < checkpoint.date;
+  }
+}
+
+void journal_t::checkpoint_posts()
+{
+  roll_up_posts();
+  if (posts_checkpointed)
+    return;
+
+  // The running balance of each key, in the order the keys first appear,
+  // as a rollup to copy and the net amount so far.
+  std::map<rollup_key_t, std::size_t>            positions;
+  std::vector<std::pair<post_t *, amount_t> >    balances;
+
+  std::vector<post_t *>::const_iterator i = rollups.begin();
+  while (i != rollups.end()) {
+    date_t date = *(*i)->_date;
+    date_t next = (date_t(date.year(), date.month(), 1) +
+                   gregorian::months(1));
+
+    for (; i != rollups.end() && *(*i)->_date < next; ++i) {
+      rollup_key_t key(**i);
+      std::map<rollup_key_t, std::size_t>::iterator found =
+        positions.find(key);
+      if (found == positions.end()) {
+        positions.insert(std::pair<rollup_key_t, std::size_t>
+                         (key, balances.size()));
+        balances.push_back(std::pair<post_t *, amount_t>
+                           (*i, (*i)->amount));
+      }
+      else if (key.commodity) {
+        balances[(*found).second].second += (*i)->amount;
+      }
+    }
+
+    checkpoint_t checkpoint;
+    checkpoint.date = next;
+    checkpoint.xact = rollup_xact(next - gregorian::days(1));
+    for (std::size_t j = 0; j < balances.size(); j++) {
+      post_t * post = rollup_post(*checkpoint.xact, *balances[j].first);
+      post->amount = balances[j].second;
+      checkpoint.posts.push_back(post);
+    }
+    checkpoints.push_back(checkpoint);
+  }
+
+  posts_checkpointed = true;
+}
+
+std::size_t journal_t::balance_posts(const date_t& end, posts_list& posts)
+{
+  checkpoint_posts();
+
+  std::vector<checkpoint_t>::const_iterator i =
+    std::upper_bound(checkpoints.begin(), checkpoints.end(), end,
+                     before_checkpoint);
+
+  optional<date_t> begin;
+  std::size_t      count = 0;
+  if (i != checkpoints.begin()) {
+    --i;
+    begin = (*i).date;
+    count = (*i).posts.size();
+    posts.insert(posts.end(), (*i).posts.begin(), (*i).posts.end());
+  }
+
+  post_sequences_t sequences;
+  posts_by_date(begin, end, sequences);
+  posts_by_sequence(sequences, posts);
+
+  return count;
+}
+
+void journal_t::clear_checkpoints()
+{
+  foreach (checkpoint_t& checkpoint, checkpoints) {
+    checked_delete(checkpoint.xact);
+    foreach (post_t * post, checkpoint.posts)
+      checked_delete(post);
+  }
+
+  checkpoints.clear();
+  posts_checkpointed = false;
+}
+
+void journal_t::clear_rollups()
+{
+  foreach (xact_t * xact, rollup_xacts)
+    checked_delete(xact);
+  foreach (post_t * post, rollups)
+    checked_delete(post);
+
+  rollup_xacts.clear();
+  rollups.clear();
+  posts_rolled_up = false;
+
+  clear_checkpoints();
+}
+
 std::size_t journal_t::read(std::istream& in,
                             const path&   pathname,
                             account_t *   master_alt,
@@ -187,15 +563,222 @@ std::size_t journal_t::read(const path& pathname,
     throw_(std::runtime_error,
            _("Cannot read journal file '%1'") << filename);
 
+  source_extent_t extent;
+  extent.filename = filename;
+  extent.master   = master;
+  extent.count    = 0;
+  extent.isolated = true;
+  extent.files.push_back(fileinfo_t(filename));
+
   ifstream stream(filename);
-  std::size_t count = read(stream, filename, master, scope);
+  std::size_t count;
+  reading_extent = &extent;
+  try {
+    count = read(stream, filename, master, scope);
+  }
+  catch (...) {
+    reading_extent = NULL;
+    throw;
+  }
+  reading_extent = NULL;
+
+  extent.count = count;
+  extents.push_back(extent);
+
   if (count > 0)
     sources.push_back(fileinfo_t(filename));
   return count;
 }
 
+namespace {
+  bool extent_changed(const journal_t::source_extent_t& extent,
+                      const std::set<path>&             touched)
+  {
+    foreach (const journal_t::fileinfo_t& info, extent.files) {
+      const path& filename(*info.filename);
+      if (touched.find(filename) != touched.end() ||
+          ! exists(filename) ||
+          file_size(filename) != info.size ||
+          posix_time::from_time_t(last_write_time(filename)) != info.modtime)
+        return true;
+    }
+    return false;
+  }
+
+  // The market prices recorded by xact_t::finalize() for postings with a
+  // cost, identified by commodity, moment and the commodity of the cost.
+  typedef std::pair<commodity_t *, std::pair<datetime_t, commodity_t *> >
+    exchange_key_t;
+
+  optional<exchange_key_t> exchange_key(const post_t& post)
+  {
+    if (! post.cost || ! post.xact)
+      return none;
+
+    return exchange_key_t(&post.amount.commodity().referent(), std::make_pair
+                          (datetime_t(post.xact->date(),
+                                      time_duration(0, 0, 0, 0)),
+                           &post.cost->commodity()));
+  }
+}
+
+bool journal_t::refresh(const std::set<path>& touched)
+{
+  // Find the files that changed since they were read.  One can be read
+  // again by itself only if neither it nor any file read after it holds
+  // directives that might have changed how the others were read.
+  std::size_t total  = 0;
+  bool        stable = true;
+  std::set<source_extent_t *> changed;
+
+  for (std::list<source_extent_t>::reverse_iterator i = extents.rbegin();
+       i != extents.rend();
+       i++) {
+    source_extent_t& extent(*i);
+    total += extent.count;
+    if (extent_changed(extent, touched)) {
+      if (! stable || ! extent.isolated || ! exists(extent.filename))
+        return false;
+      changed.insert(&extent);
+    }
+    if (! extent.isolated)
+      stable = false;
+  }
+
+  if (changed.empty())
+    return true;
+  if (total != xacts.size())
+    return false;
+
+  // Xacts are always finalized against their primary dates when read.
+  bool use_effective_date = item_t::use_effective_date;
+  item_t::use_effective_date = false;
+
+  std::set<exchange_key_t> exchanges;
+  xacts_list::iterator     pos = xacts.begin();
+
+  foreach (source_extent_t& extent, extents) {
+    if (changed.find(&extent) == changed.end()) {
+      std::advance(pos, extent.count);
+      continue;
+    }
+
+    DEBUG("journal.refresh", "reading again " << extent.filename);
+
+    // Unhook the file's old xacts from their accounts and from the
+    // market prices their costs established, then delete them.
+    xacts_list old_xacts;
+    xacts_list::iterator end = pos;
+    std::advance(end, extent.count);
+    old_xacts.splice(old_xacts.begin(), xacts, pos, end);
+    pos = end;
+
+    std::set<post_t *>     old_posts;
+    std::set<account_t *>  old_accounts;
+    foreach (xact_t * xact, old_xacts) {
+      foreach (post_t * post, xact->posts) {
+        old_posts.insert(post);
+        if (post->account)
+          old_accounts.insert(post->account);
+        if (optional<exchange_key_t> key = exchange_key(*post))
+          exchanges.insert(*key);
+      }
+    }
+    foreach (account_t * account, old_accounts) {
+      for (posts_list::iterator i = account->posts.begin();
+           i != account->posts.end(); )
+        if (old_posts.find(*i) != old_posts.end())
+          account->posts.erase(i++);
+        else
+          i++;
+    }
+    foreach (xact_t * xact, old_xacts)
+      checked_delete(xact);
+
+    // Read the file again, and move its new xacts to where the old ones
+    // were.  An error leaves the journal to be reloaded from scratch.
+    extent.files.clear();
+    extent.files.push_back(fileinfo_t(extent.filename));
+    extent.isolated = true;
+
+    ifstream stream(extent.filename);
+    std::size_t count;
+    reading_extent = &extent;
+    try {
+      count = read(stream, extent.filename, extent.master);
+    }
+    catch (...) {
+      reading_extent = NULL;
+      item_t::use_effective_date = use_effective_date;
+      throw;
+    }
+    reading_extent = NULL;
+    extent.count = count;
+
+    // The file's sources entry must describe what was just read, or the
+    // next refresh would compare against the old size and time.
+    bool listed = false;
+    foreach (fileinfo_t& info, sources) {
+      if (info.filename && *info.filename == extent.filename) {
+        info   = fileinfo_t(extent.filename);
+        listed = true;
+      }
+    }
+    if (! listed && count > 0)
+      sources.push_back(fileinfo_t(extent.filename));
+
+    xacts_list::iterator first = xacts.end();
+    for (std::size_t n = 0; n < count; n++)
+      first--;
+    for (xacts_list::iterator i = first; i != xacts.end(); i++)
+      foreach (post_t * post, (*i)->posts)
+        if (optional<exchange_key_t> key = exchange_key(*post))
+          exchanges.insert(*key);
+    xacts.splice(pos, xacts, first, xacts.end());
+
+    if (! extent.isolated) {
+      item_t::use_effective_date = use_effective_date;
+      return false;
+    }
+  }
+
+  // Prices established at the same moment by P directives or other xacts
+  // were overwritten or removed along with the old ones, so record them
+  // again in order.  Every P directive was read before any file that can
+  // be refreshed, so the xacts' own prices still take precedence.
+  if (! exchanges.empty()) {
+    foreach (const exchange_key_t& key, exchanges) {
+      key.first->remove_price(key.second.first, *key.second.second);
+      key.second.second->remove_price(key.second.first, *key.first);
+    }
+    foreach (price_directives_list::value_type& point, price_directives) {
+      exchange_key_t key(&point.first->referent(),
+                         std::make_pair(point.second.when,
+                                        &point.second.price.commodity()));
+      if (exchanges.find(key) != exchanges.end())
+        point.first->add_price(point.second.when, point.second.price, true);
+    }
+    foreach (xact_t * xact, xacts)
+      foreach (post_t * post, xact->posts)
+        if (optional<exchange_key_t> key = exchange_key(*post))
+          if (exchanges.find(*key) != exchanges.end())
+            commodity_pool_t::current_pool->exchange
+              (post->amount, *post->cost, false, key->second.first);
+  }
+
+  item_t::use_effective_date = use_effective_date;
+
+  posts_indexed = false;
+  clear_xdata();
+
+  return true;
+}
+
 bool journal_t::has_xdata()
 {
+  if (current_xdata_table)
+    return ! current_xdata_table->empty();
+
   foreach (xact_t * xact, xacts)
     if (xact->has_xdata())
       return true;
@@ -228,6 +811,12 @@ void journal_t::clear_xdata()
     if (! xact->has_flags(ITEM_TEMP))
       xact->clear_xdata();
 
+  foreach (post_t * post, rollups)
+    post->clear_xdata();
+  foreach (checkpoint_t& checkpoint, checkpoints)
+    foreach (post_t * post, checkpoint.posts)
+      post->clear_xdata();
+
   master->clear_xdata();
 }
 
@@ -45,17 +45,21 @@
 #include "utils.h"
 #include "times.h"
 #include "mask.h"
+#include "amount.h"
+#include "commodity.h"
 
 namespace ledger {
 
 class xact_base_t;
 class xact_t;
+class post_t;
 class auto_xact_t;
 class period_xact_t;
 class account_t;
 class scope_t;
 
 typedef std::list<xact_t *>        xacts_list;
+typedef std::list<post_t *>        posts_list;
 typedef std::list<auto_xact_t *>   auto_xacts_list;
 typedef std::list<period_xact_t *> period_xacts_list;
 
@@ -119,6 +123,89 @@ public:
   account_mappings_t    account_mappings;
   bool                  was_loaded;
 
+  // Indexes over every posting in xacts, built on demand by index_posts()
+  // and discarded whenever an xact is added or removed.  Postings are
+  // identified by their sequence in journal order, and each index maps a
+  // key to the ascending sequences of the postings that have it.  The
+  // keyed indexes are only built by index_keys() once a query needs them.
+  enum post_index_t {
+    PAYEE_INDEX,
+    CODE_INDEX,
+    TAG_INDEX,
+    COMMODITY_INDEX,
+    POST_INDEXES
+  };
+
+  typedef std::vector<std::size_t>           post_sequences_t;
+  typedef std::map<string, post_sequences_t> post_index_map;
+
+  struct dated_post_t
+  {
+    date_t      date;
+    std::size_t sequence;
+
+    bool operator<(const dated_post_t& other) const {
+      return (date < other.date ||
+              (date == other.date && sequence < other.sequence));
+    }
+  };
+
+  std::vector<post_t *>     indexed_posts;
+  std::vector<dated_post_t> dated_posts;
+  post_index_map            post_indexes[POST_INDEXES];
+  bool                      keys_indexed[POST_INDEXES];
+  std::size_t               indexed_xacts;
+  bool                      indexed_effective;
+  bool                      posts_indexed;
+
+  // Daily rollups of the same postings, built on demand by roll_up_posts()
+  // and dropped along with the indexes: for each day, one posting per
+  // account, commodity and kind of posting (real, balanced virtual or
+  // virtual), carrying the net amount posted there that day.  They are
+  // kept in date order, and their xacts are owned here too.  They live
+  // only as long as a resident session and are not saved with --cache.
+  std::vector<post_t *>     rollups;
+  std::vector<xact_t *>     rollup_xacts;
+  bool                      posts_rolled_up;
+
+  // Balances as of the start of each month following one with postings,
+  // built from the rollups by checkpoint_posts(): one posting per account,
+  // commodity and kind of posting, carrying the net amount of everything
+  // posted before that date.  Like the rollups, they are rebuilt by each
+  // resident session and are not saved with --cache.
+  struct checkpoint_t
+  {
+    date_t                date;
+    xact_t *              xact;
+    std::vector<post_t *> posts;
+  };
+
+  std::vector<checkpoint_t> checkpoints;
+  bool                      posts_checkpointed;
+
+  // Every file read through read(path), in the order read, with the files
+  // it included and the number of xacts it added.  A file is isolated if
+  // it held nothing but xacts, comments and includes; refresh() may then
+  // replace its xacts without reparsing any other file.
+  struct source_extent_t
+  {
+    path                  filename;
+    account_t *           master;
+    std::list<fileinfo_t> files;
+    std::size_t           count;
+    bool                  isolated;
+  };
+
+  std::list<source_extent_t> extents;
+  source_extent_t *          reading_extent;
+
+  // The market prices set by P directives, in the order read, so that
+  // refresh() can restore any that the costs of re-read xacts replaced.
+  typedef std::list<std::pair<commodity_t *, price_point_t> >
+    price_directives_list;
+
+  price_directives_list price_directives;
+
   journal_t();
   journal_t(const path& pathname);
   journal_t(const string& str);
@@ -144,6 +231,28 @@ public:
   void extend_xact(xact_base_t * xact);
   bool remove_xact(xact_t * xact);
 
+  void index_posts();
+  void index_keys(const post_index_t index);
+  void posts_by_date(const optional<date_t>& begin,
+                     const optional<date_t>& end,
+                     post_sequences_t&       sequences);
+  void posts_by_key(const post_index_t index, const string& key,
+                    post_sequences_t& sequences);
+  void posts_by_key(const post_index_t index, const mask_t& mask,
+                    post_sequences_t& sequences);
+  void posts_by_sequence(const post_sequences_t& sequences,
+                         posts_list&             posts);
+
+  void roll_up_posts();
+  void rollups_by_date(const optional<date_t>& begin,
+                       const optional<date_t>& end,
+                       posts_list&             posts);
+  void clear_rollups();
+
+  void checkpoint_posts();
+  std::size_t balance_posts(const date_t& end, posts_list& posts);
+  void clear_checkpoints();
+
   xacts_list::iterator xacts_begin() {
     return xacts.begin();
   }
@@ -171,6 +280,8 @@ public:
                    account_t *   master = NULL,
                    scope_t *     scope  = NULL);
 
+  bool refresh(const std::set<path>& touched = std::set<path>());
+
   std::size_t parse(std::istream& in,
                     scope_t&      session_scope,
                     account_t *   master        = NULL,
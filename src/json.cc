@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2003-2010, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <system.hh>
+
+#include "json.h"
+#include "xact.h"
+#include "post.h"
+#include "account.h"
+#include "session.h"
+#include "report.h"
+
+namespace ledger {
+
+void json_writer_t::end_object()
+{
+  buffer += "}\n";
+  write_if_full();
+}
+
+void json_writer_t::write_key(const char * name)
+{
+  if (first_member)
+    first_member = false;
+  else
+    buffer += ',';
+
+  buffer += '"';
+  buffer += name;
+  buffer += "\":";
+}
+
+void json_writer_t::write_string(const string& str)
+{
+  buffer += '"';
+
+  // Most strings need no escaping at all, and can be copied whole.
+  string::size_type start = 0;
+  for (string::size_type i = 0; i < str.length(); i++) {
+    unsigned char ch = static_cast<unsigned char>(str[i]);
+    if (ch >= 0x20 && ch != '"' && ch != '\\')
+      continue;
+
+    buffer.append(str, start, i - start);
+    start = i + 1;
+
+    switch (ch) {
+    case '"':  buffer += "\\\""; break;
+    case '\\': buffer += "\\\\"; break;
+    case '\n': buffer += "\\n";  break;
+    case '\r': buffer += "\\r";  break;
+    case '\t': buffer += "\\t";  break;
+    default: {
+      char code[8];
+      std::sprintf(code, "\\u%04x", static_cast<unsigned int>(ch));
+      buffer += code;
+      break;
+    }
+    }
+  }
+  buffer.append(str, start, string::npos);
+
+  buffer += '"';
+}
+
+void json_writer_t::write_number(const long num)
+{
+  char digits[32];
+  std::sprintf(digits, "%ld", num);
+  buffer += digits;
+}
+
+void json_writer_t::write_value(const value_t& val)
+{
+  switch (val.type()) {
+  case value_t::VOID:
+    write_null();
+    break;
+
+  case value_t::BALANCE: {
+    // A balance becomes an array of its non-zero amounts, in the order
+    // the text reports print them.
+    typedef std::vector<const amount_t *> amounts_array;
+    amounts_array sorted;
+
+    foreach (const balance_t::amounts_map::value_type& pair,
+             val.as_balance().amounts)
+      if (pair.second)
+        sorted.push_back(&pair.second);
+
+    // A balance left with fewer than two amounts prints like an amount,
+    // as it does in the text reports.
+    if (sorted.empty()) {
+      write_string("0");
+      break;
+    }
+    if (sorted.size() == 1) {
+      write_string(sorted.front()->to_string());
+      break;
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     commodity_t::compare_by_commodity());
+
+    buffer += '[';
+    bool first = true;
+    foreach (const amount_t * amount, sorted) {
+      if (first)
+        first = false;
+      else
+        buffer += ',';
+      write_string(amount->to_string());
+    }
+    buffer += ']';
+    break;
+  }
+
+  default:
+    write_string(val.to_string());
+    break;
+  }
+}
+
+format_json_posts::format_json_posts(report_t& _report)
+  : report(_report), writer(report.output_stream)
+{
+  TRACE_CTOR(format_json_posts, "report&");
+}
+
+void format_json_posts::flush()
+{
+  writer.flush();
+}
+
+void format_json_posts::write_row(post_t& post, const char *& expr)
+{
+  bind_scope_t bound_scope(report, post);
+
+  writer.begin_object();
+
+  if (! report_title.empty())
+    writer.member("group", report_title);
+
+  writer.member("date", format_date(post.date(), FMT_WRITTEN));
+  if (post.xact->code)
+    writer.member("code", *post.xact->code);
+  writer.member("payee", post.payee());
+  writer.member("account", post.reported_account()->fullname());
+
+  if (post.has_flags(POST_VIRTUAL)) {
+    writer.write_key("virtual");
+    writer.write_string(post.must_balance() ? "balanced" : "unbalanced");
+  }
+
+  switch (post.state()) {
+  case item_t::CLEARED:
+    writer.member("state", "cleared");
+    break;
+  case item_t::PENDING:
+    writer.member("state", "pending");
+    break;
+  default:
+    writer.member("state", "uncleared");
+    break;
+  }
+
+  expr = "scrub(display_amount)";
+  writer.write_key("amount");
+  writer.write_value(report.display_value
+                     (report.HANDLER(display_amount_).expr.calc(bound_scope)));
+  expr = "scrub(display_total)";
+  writer.write_key("total");
+  writer.write_value(report.display_value
+                     (report.HANDLER(display_total_).expr.calc(bound_scope)));
+  expr = NULL;
+
+  if (post.note || post.xact->note)
+    writer.member("note", joined_note(post));
+
+  writer.end_object();
+}
+
+void format_json_posts::operator()(post_t& post)
+{
+  if (post.has_xdata() && post.xdata().has_flags(POST_EXT_DISPLAYED))
+    return;
+
+  // Should a member's value fail to compute, the rows before this one are
+  // still written, and the error names the member's expression, as the
+  // CSV report does for its columns.
+  string::size_type row_start = writer.buffer.size();
+  const char *      expr      = NULL;
+  try {
+    write_row(post, expr);
+  }
+  catch (const std::exception&) {
+    writer.buffer.erase(row_start);
+    writer.write();
+
+    if (expr) {
+      string current_context = error_context();
+
+      add_error_context(_("While evaluating value expression:"));
+      add_error_context(string("  ") + expr);
+
+      if (! current_context.empty())
+        add_error_context(current_context);
+    }
+    throw;
+  }
+
+  post.xdata().add_flags(POST_EXT_DISPLAYED);
+}
+
+format_json_accounts::format_json_accounts(report_t& _report)
+  : format_accounts(_report, ""), writer(report.output_stream)
+{
+  TRACE_CTOR(format_json_accounts, "report&");
+}
+
+std::size_t format_json_accounts::post_account(account_t& account,
+                                               const bool flat)
+{
+  if (! flat && account.parent)
+    post_account(*account.parent, flat);
+
+  if (account.xdata().has_flags(ACCOUNT_EXT_TO_DISPLAY) &&
+      ! account.xdata().has_flags(ACCOUNT_EXT_DISPLAYED)) {
+    account.xdata().add_flags(ACCOUNT_EXT_DISPLAYED);
+
+    bind_scope_t bound_scope(report, account);
+
+    writer.begin_object();
+
+    if (! report_title.empty())
+      writer.member("group", report_title);
+
+    writer.member("account", account.fullname());
+    writer.write_key("depth");
+    writer.write_number(account.depth);
+
+    writer.write_key("amount");
+    writer.write_value(report.display_value
+                       (report.HANDLER(display_amount_).expr.calc(bound_scope)));
+    writer.write_key("total");
+    writer.write_value(report.display_value
+                       (report.HANDLER(display_total_).expr.calc(bound_scope)));
+
+    writer.end_object();
+    return 1;
+  }
+  return 0;
+}
+
+void format_json_accounts::flush()
+{
+  if (report.HANDLED(display_))
+    disp_pred.parse(report.HANDLER(display_).str());
+
+  mark_accounts(*report.session.journal->master, report.HANDLED(flat));
+
+  foreach (account_t * account, posted_accounts)
+    post_account(*account, report.HANDLED(flat));
+
+  report_title = "";
+  writer.flush();
+}
+
+} // namespace ledger
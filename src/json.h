@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2003-2010, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup report
+ */
+
+/**
+ * @file   json.h
+ * @author John Wiegley
+ *
+ * @ingroup report
+ *
+ * @brief Write register and balance reports as JSON lines.
+ *
+ * Each posting or account becomes one JSON object on a line of its own,
+ * written as soon as the handler chain hands it over, so readers can
+ * consume a report of any size in constant memory.
+ */
+#ifndef _JSON_H
+#define _JSON_H
+
+#include "chain.h"
+#include "output.h"
+
+namespace ledger {
+
+class report_t;
+
+/**
+ * @brief Accumulates JSON text and writes it out in large pieces
+ */
+class json_writer_t : public output_buffer_t
+{
+  bool first_member;
+
+public:
+  json_writer_t(output_stream_t& _out)
+    : output_buffer_t(_out), first_member(true) {
+    TRACE_CTOR(json_writer_t, "output_stream_t&");
+  }
+  ~json_writer_t() {
+    TRACE_DTOR(json_writer_t);
+  }
+
+  void begin_object() {
+    buffer += '{';
+    first_member = true;
+  }
+  void end_object();
+
+  void write_key(const char * name);
+  void write_string(const string& str);
+  void write_number(const long num);
+  void write_null() {
+    buffer += "null";
+  }
+  void write_value(const value_t& val);
+
+  void member(const char * name, const string& str) {
+    write_key(name);
+    write_string(str);
+  }
+};
+
+/**
+ * @brief Register report postings as JSON lines
+ *
+ * A group title from --group-by is repeated in each posting's "group"
+ * member rather than written as a separate line.
+ */
+class format_json_posts : public item_handler<post_t>
+{
+protected:
+  report_t&     report;
+  json_writer_t writer;
+  string        report_title;
+
+  void write_row(post_t& post, const char *& expr);
+
+public:
+  format_json_posts(report_t& _report);
+  virtual ~format_json_posts() {
+    TRACE_DTOR(format_json_posts);
+  }
+
+  virtual void title(const string& str) {
+    report_title = str;
+  }
+
+  virtual void flush();
+  virtual void operator()(post_t& post);
+
+  virtual void clear() {
+    report_title = "";
+    item_handler<post_t>::clear();
+  }
+};
+
+/**
+ * @brief Balance report accounts as JSON lines
+ *
+ * Accounts are chosen exactly as for the text balance report; each one
+ * carries its full name and depth rather than the indented partial name,
+ * and no grand total line is written.
+ */
+class format_json_accounts : public format_accounts
+{
+protected:
+  json_writer_t writer;
+
+public:
+  format_json_accounts(report_t& _report);
+  virtual ~format_json_accounts() {
+    TRACE_DTOR(format_json_accounts);
+  }
+
+  virtual std::size_t post_account(account_t& account, const bool flat);
+  virtual void        flush();
+};
+
+} // namespace ledger
+
+#endif // _JSON_H
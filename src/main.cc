@@ -80,6 +80,17 @@ int main(int argc, char * argv[], char * envp[])
   ::textdomain("ledger");
 #endif
 
+  // A client only forwards its command-line to a running daemon, so it
+  // reads neither the init file nor any journal data of its own.
+  try {
+    if (optional<int> client_status = handle_client_option(argc, argv))
+      return *client_status;
+  }
+  catch (const std::exception& err) {
+    std::cerr << _("Error: ") << err.what() << std::endl;
+    return 1;
+  }
+
   std::auto_ptr<global_scope_t> global_scope;
 
   try {
@@ -116,6 +127,11 @@ int main(int argc, char * argv[], char * envp[])
                                                          true);
       }
     }
+    else if (global_scope->HANDLED(daemon_)) {
+      // Keep the journal in memory and answer the command-lines of clients
+      global_scope->serve_requests(global_scope->HANDLER(daemon_).str());
+      status = 0;
+    }
     else if (! args.empty()) {
       // User has invoke a verb at the interactive command-line
       status = global_scope->execute_command_wrapper(args, false);
@@ -124,7 +140,9 @@ int main(int argc, char * argv[], char * envp[])
       // Commence the REPL by displaying the current Ledger version
       global_scope->show_version_info(std::cout);
 
+      global_scope->session().resident = true;
       global_scope->session().read_journal_files();
+      global_scope->session().watch_journal_files();
 
       bool exit_loop = false;
 
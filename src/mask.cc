@@ -35,6 +35,170 @@
 
 namespace ledger {
 
+namespace {
+  inline char fold_case(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+  }
+
+  // A pattern made of nothing but printable ASCII characters without any
+  // special meaning matches exactly where its case-folded text occurs.
+  bool literal_pattern(const string& pat, bool& anchored, string& literal)
+  {
+    string::size_type i = 0;
+    anchored = ! pat.empty() && pat[0] == '^';
+    if (anchored)
+      i++;
+
+    literal.clear();
+    for (; i < pat.length(); i++) {
+      char c = pat[i];
+      if (c < ' ' || c > '~' || std::strchr("\\^$.|?*+()[]{}", c)) {
+        literal.clear();
+        return false;
+      }
+      literal += fold_case(c);
+    }
+    return true;
+  }
+
+  typedef std::list<std::pair<bool, string> > literal_list;
+
+  // A pattern such as "^food|travel", in which every alternative is a
+  // literal pattern, matches wherever one of those literals would.  This
+  // is also how assign_any writes a set of words, so the kind of mask
+  // survives being printed and parsed again.
+  bool literal_alternatives(const string& pat, literal_list& literals)
+  {
+    literals.clear();
+
+    string::size_type start = 0;
+    while (true) {
+      string::size_type end = pat.find('|', start);
+      bool   anchored;
+      string literal;
+      if (! literal_pattern(pat.substr(start, end == string::npos ?
+                                       string::npos : end - start),
+                            anchored, literal)) {
+        literals.clear();
+        return false;
+      }
+      literals.push_back(literal_list::value_type(anchored, literal));
+
+      if (end == string::npos)
+        break;
+      start = end + 1;
+    }
+    return true;
+  }
+}
+
+/**
+ * The literal alternatives of a MATCH_ANY mask.  Anchored literals are
+ * kept in a trie which is walked from the start of the text; all the
+ * others are compiled into an Aho-Corasick automaton, so that the text
+ * is scanned once no matter how many alternatives there are.  States
+ * are numbered from zero, each with a row of 128 transitions.
+ */
+struct mask_t::alternatives_t
+{
+  std::vector<int>  prefix_next;
+  std::vector<bool> prefix_final;
+  std::vector<int>  search_next;
+  std::vector<bool> search_final;
+
+  static int add(std::vector<int>&  next,
+                 std::vector<bool>& final_states,
+                 const string&      literal)
+  {
+    if (final_states.empty()) {
+      next.resize(128, -1);
+      final_states.push_back(false);
+    }
+
+    int state = 0;
+    foreach (char c, literal) {
+      std::size_t index = std::size_t(state) * 128 + std::size_t(c);
+      if (next[index] < 0) {
+        next[index] = int(final_states.size());
+        next.resize(next.size() + 128, -1);
+        final_states.push_back(false);
+      }
+      state = next[index];
+    }
+    final_states[std::size_t(state)] = true;
+    return state;
+  }
+
+  void build_search_links()
+  {
+    if (search_final.empty())
+      return;
+
+    std::vector<int> fail(search_final.size(), 0);
+    std::deque<int>  queue;
+
+    for (std::size_t c = 0; c < 128; c++) {
+      int& target(search_next[c]);
+      if (target < 0) {
+        target = 0;
+      } else {
+        fail[std::size_t(target)] = 0;
+        queue.push_back(target);
+      }
+    }
+
+    while (! queue.empty()) {
+      std::size_t state = std::size_t(queue.front());
+      std::size_t link  = std::size_t(fail[state]);
+      queue.pop_front();
+
+      if (search_final[link])
+        search_final[state] = true;
+
+      for (std::size_t c = 0; c < 128; c++) {
+        int& target(search_next[state * 128 + c]);
+        int  fallback = search_next[link * 128 + c];
+        if (target < 0) {
+          target = fallback;
+        } else {
+          fail[std::size_t(target)] = fallback;
+          queue.push_back(target);
+        }
+      }
+    }
+  }
+
+  bool match(const char * p, std::size_t len) const
+  {
+    if (! prefix_final.empty()) {
+      if (prefix_final[0])
+        return true;
+      int state = 0;
+      for (std::size_t i = 0; i < len; i++) {
+        state = prefix_next[std::size_t(state) * 128 +
+                            std::size_t(fold_case(p[i]))];
+        if (state < 0)
+          break;
+        if (prefix_final[std::size_t(state)])
+          return true;
+      }
+    }
+
+    if (! search_final.empty()) {
+      if (search_final[0])
+        return true;
+      int state = 0;
+      for (std::size_t i = 0; i < len; i++) {
+        state = search_next[std::size_t(state) * 128 +
+                            std::size_t(fold_case(p[i]))];
+        if (search_final[std::size_t(state)])
+          return true;
+      }
+    }
+    return false;
+  }
+};
+
 mask_t::mask_t(const string& pat) : expr()
 {
   TRACE_CTOR(mask_t, "const string&");
@@ -49,9 +213,108 @@ mask_t& mask_t::operator=(const string& pat)
   expr.assign(pat.c_str(), boost::regex::perl | boost::regex::icase);
 #endif
   VERIFY(valid());
+
+  alternatives.reset();
+
+  bool         anchored;
+  literal_list literals;
+  if (literal_pattern(pat, anchored, literal)) {
+    kind = anchored ? MATCH_PREFIX : MATCH_SUBSTRING;
+  }
+  else if (pat.find('|') != string::npos &&
+           literal_alternatives(pat, literals)) {
+    shared_ptr<alternatives_t> alts(new alternatives_t);
+    foreach (const literal_list::value_type& lit, literals) {
+      if (lit.first)
+        alternatives_t::add(alts->prefix_next, alts->prefix_final,
+                            lit.second);
+      else
+        alternatives_t::add(alts->search_next, alts->search_final,
+                            lit.second);
+    }
+    alts->build_search_links();
+
+    kind         = MATCH_ANY;
+    alternatives = alts;
+  }
+  else {
+    kind = MATCH_REGEX;
+  }
+
   return *this;
 }
 
+mask_t& mask_t::assign_any(const std::list<string>& patterns)
+{
+  // Words are joined as they are, which the assignment below recognizes
+  // as a set of literals; anything else is grouped to keep it intact.
+  bool         words = true;
+  literal_list literals;
+  foreach (const string& pat, patterns) {
+    if (! literal_alternatives(pat, literals)) {
+      words = false;
+      break;
+    }
+  }
+
+  std::ostringstream buf;
+  bool first = true;
+  foreach (const string& pat, patterns) {
+    if (first)
+      first = false;
+    else
+      buf << '|';
+    if (words)
+      buf << pat;
+    else
+      buf << "(?:" << pat << ')';
+  }
+  return *this = buf.str();
+}
+
+bool mask_t::match_literal(const string& text, bool& result) const
+{
+  const char *      p   = text.c_str();
+  string::size_type len = text.length();
+
+  bool anchored = (kind == MATCH_PREFIX ||
+                   (kind == MATCH_ANY && ! alternatives->prefix_final.empty()));
+
+  // Outside of plain ASCII, case-insensitive matching is up to the regex
+  // library.  For an anchored pattern, so is anything which it might
+  // consider the start of a new line.
+  for (string::size_type i = 0; i < len; i++) {
+    unsigned char c = static_cast<unsigned char>(p[i]);
+    if (c >= 0x80 || (anchored && (c == '\n' || c == '\r' || c == '\f')))
+      return false;
+  }
+
+  if (kind == MATCH_ANY) {
+    result = alternatives->match(p, len);
+    return true;
+  }
+
+  const char *      lit     = literal.c_str();
+  string::size_type lit_len = literal.length();
+
+  result = false;
+  if (lit_len > len)
+    return true;
+
+  string::size_type last = kind == MATCH_PREFIX ? 0 : len - lit_len;
+  for (string::size_type start = 0; start <= last; start++) {
+    string::size_type j = 0;
+    for (; j < lit_len; j++)
+      if (fold_case(p[start + j]) != lit[j])
+        break;
+    if (j == lit_len) {
+      result = true;
+      break;
+    }
+  }
+  return true;
+}
+
 mask_t& mask_t::assign_glob(const string& pat)
 {
   string re_pat = "";
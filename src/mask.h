@@ -60,12 +60,31 @@ public:
   boost::regex expr;
 #endif
 
+  // Most patterns are plain words, perhaps anchored at the start.  Those
+  // are matched by comparing text directly, and the regular expression
+  // is only run for the rest (or for text the comparison cannot decide).
+  // MATCH_ANY is a set of such words, such as "^food|travel".
+  enum match_kind_t {
+    MATCH_REGEX,
+    MATCH_SUBSTRING,
+    MATCH_PREFIX,
+    MATCH_ANY
+  };
+
+  struct alternatives_t;
+
+  match_kind_t               kind;
+  string                     literal; // lowercased, for SUBSTRING/PREFIX
+  shared_ptr<alternatives_t> alternatives;
+
   explicit mask_t(const string& pattern);
 
-  mask_t() : expr() {
+  mask_t() : expr(), kind(MATCH_REGEX) {
     TRACE_CTOR(mask_t, "");
   }
-  mask_t(const mask_t& m) : expr(m.expr) {
+  mask_t(const mask_t& m)
+    : expr(m.expr), kind(m.kind), literal(m.literal),
+      alternatives(m.alternatives) {
     TRACE_CTOR(mask_t, "copy");
   }
   ~mask_t() throw() {
@@ -75,6 +94,13 @@ public:
   mask_t& operator=(const string& other);
   mask_t& assign_glob(const string& other);
 
+  /**
+   * Make this mask match wherever any of the given patterns would.  If
+   * every pattern is a plain word, or a set of them, the text is scanned
+   * only once.
+   */
+  mask_t& assign_any(const std::list<string>& patterns);
+
   bool operator<(const mask_t& other) const {
     return expr < other.expr;
   }
@@ -83,6 +109,15 @@ public:
   }
 
   bool match(const string& text) const {
+    if (kind != MATCH_REGEX) {
+      bool result;
+      if (match_literal(text, result)) {
+        DEBUG("mask.match",
+              "Matching: \"" << text << "\" =~ /" << str() << "/ = "
+              << (result ? "true" : "false") << " (literal)");
+        return result;
+      }
+    }
 #if defined(HAVE_BOOST_REGEX_UNICODE)
     DEBUG("mask.match",
           "Matching: \"" << text << "\" =~ /" << str() << "/ = "
@@ -96,6 +131,8 @@ public:
 #endif
   }
 
+  bool match_literal(const string& text, bool& result) const;
+
   bool empty() const {
     return expr.empty();
   }
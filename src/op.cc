@@ -129,20 +129,128 @@ expr_t::ptr_op_t expr_t::op_t::compile(scope_t& scope, const int depth)
                (kind == O_LOOKUP ? right() :
                 right()->compile(scope, depth)) : NULL);
 
+  // Logical operators whose outcome is settled by a constant left operand
+  // can be reduced even if the right operand is not constant.
+  if (lhs && lhs->is_value() && rhs) {
+    switch (kind) {
+    case O_AND:
+      if (! lhs->as_value())
+        return wrap_value(false);
+      return rhs;
+    case O_OR:
+      if (lhs->as_value())
+        return lhs;
+      return rhs;
+    case O_QUERY:
+      assert(rhs->kind == O_COLON);
+      return lhs->as_value() ? rhs->left() : rhs->right();
+    default:
+      break;
+    }
+  }
+
+  // Reduce constants immediately if possible.  This must come before the
+  // check for unchanged operands, since constants compile to themselves.
+  // Only the arithmetic, comparison and logical operators are reduced;
+  // the operators from O_QUERY on are syntax (such as O_COLON, or O_CONS
+  // in a function's argument list) or need a scope of their own.
+  if (kind < O_QUERY &&
+      (! lhs || lhs->is_value()) && (! rhs || rhs->is_value())) {
+    if (lhs == left() && (! rhs || rhs == right()))
+      return wrap_value(calc(scope, NULL, depth));
+    return wrap_value(copy(lhs, rhs)->calc(scope, NULL, depth));
+  }
+
   if (lhs == left() && (! rhs || rhs == right()))
     return this;
 
-  ptr_op_t intermediate(copy(lhs, rhs));
+  return copy(lhs, rhs);
+}
+
+expr_t::ptr_op_t
+expr_t::op_t::merge_common(const shared_ptr<expr_t::memo_t>& memo_ptr,
+                           std::map<string, ptr_op_t>&        seen,
+                           string&                            signature)
+{
+  signature.clear();
+
+  switch (kind) {
+  case VALUE: {
+    // Constants are compared by value, but they are cheap enough to
+    // evaluate that they are never merged themselves.
+    std::ostringstream buf;
+    buf << 'V' << static_cast<int>(as_value().type()) << ':';
+    as_value().dump(buf, true);
+    signature = buf.str();
+    return this;
+  }
+
+  case IDENT:
+    // Only identifiers which were resolved at compile time mean the same
+    // thing wherever they occur within the expression.
+    if (left())
+      signature = "I:" + as_ident();
+    break;
 
-  // Reduce constants immediately if possible
-  if ((! lhs || lhs->is_value()) && (! rhs || rhs->is_value()))
-    return wrap_value(intermediate->calc(scope, NULL, depth));
+  case FUNCTION:
+  case ACCESSOR:
+  case O_DEFINE:
+  case O_LAMBDA:
+  case O_LOOKUP:
+  case O_SEQ:
+    return this;
 
-  return intermediate;
+  default: {
+    string lsig, rsig;
+    if (left()) {
+      ptr_op_t lhs(left()->merge_common(memo_ptr, seen, lsig));
+      if (lhs != left())
+        set_left(lhs);
+    }
+    if (kind == O_CALL && has_right()) {
+      // A function may evaluate its arguments in scopes of its own, such
+      // as any() does once per posting, so nothing within them can share
+      // a remembered value with the rest of the expression.  They still
+      // contribute to the signature of the call as a whole.
+      std::map<string, ptr_op_t> args_seen;
+      right()->merge_common(shared_ptr<expr_t::memo_t>(), args_seen, rsig);
+    }
+    else if (kind > UNARY_OPERATORS && has_right()) {
+      ptr_op_t rhs(right()->merge_common(memo_ptr, seen, rsig));
+      if (rhs != right())
+        set_right(rhs);
+    }
+
+    if ((left() && lsig.empty()) ||
+        (kind > UNARY_OPERATORS && has_right() && rsig.empty()))
+      return this;
+
+    std::ostringstream buf;
+    buf << '(' << static_cast<int>(kind) << ' ' << lsig << ' ' << rsig << ')';
+    signature = buf.str();
+    break;
+  }
+  }
+
+  std::map<string, ptr_op_t>::iterator i = seen.find(signature);
+  if (i != seen.end()) {
+    DEBUG("expr.compile", "Merging common subexpression " << signature);
+    (*i).second->memo = memo_ptr;
+    return (*i).second;
+  }
+  seen.insert(std::map<string, ptr_op_t>::value_type(signature, this));
+  return this;
 }
 
 value_t expr_t::op_t::calc(scope_t& scope, ptr_op_t * locus, const int depth)
 {
+  if (memo && memo->active && memo_generation == memo->generation &&
+      memo_context == scope.type_context()) {
+    if (kind == IDENT || kind == O_CALL)
+      check_type_context(scope, memo_value);
+    return memo_value;
+  }
+
 #if defined(DEBUG_ON)
   bool skip_debug = false;
 #endif
@@ -179,6 +287,14 @@ value_t expr_t::op_t::calc(scope_t& scope, ptr_op_t * locus, const int depth)
     if (! definition)
       throw_(calc_error, _("Unknown identifier '%1'") << as_ident());
 
+    // An accessor only needs the scope to find its object in, so it is
+    // invoked directly rather than through an implicit call.
+    if (definition->is_accessor()) {
+      result = (*definition->as_accessor())(scope);
+      check_type_context(scope, result);
+      break;
+    }
+
     // Evaluating an identifier is the same as calling its definition
     // directly, so we create an empty call_scope_t to reflect the scope for
     // this implicit call.
@@ -202,6 +318,16 @@ value_t expr_t::op_t::calc(scope_t& scope, ptr_op_t * locus, const int depth)
     break;
   }
 
+  case ACCESSOR:
+    // Accessors need nothing but the scope to find their object in, so
+    // no call_scope_t is needed to invoke them.
+    result = (*as_accessor())(scope);
+    check_type_context(scope, result);
+#if defined(DEBUG_ON)
+    skip_debug = true;
+#endif
+    break;
+
   case O_LAMBDA: {
     call_scope_t&  call_args(downcast<call_scope_t>(scope));
     std::size_t    args_count(call_args.size());
@@ -435,6 +561,12 @@ value_t expr_t::op_t::calc(scope_t& scope, ptr_op_t * locus, const int depth)
   }
 #endif
 
+  if (memo && memo->active) {
+    memo_generation = memo->generation;
+    memo_context    = scope.type_context();
+    memo_value      = result;
+  }
+
   return result;
 
   }
@@ -515,6 +647,10 @@ bool expr_t::op_t::print(std::ostream& out, const context_t& context) const
     out << "<FUNCTION>";
     break;
 
+  case ACCESSOR:
+    out << "<ACCESSOR>";
+    break;
+
   case O_NOT:
     out << "! ";
     if (left() && left()->print(out, context))
@@ -726,6 +862,10 @@ void expr_t::op_t::dump(std::ostream& out, const int depth) const
     out << "FUNCTION";
     break;
 
+  case ACCESSOR:
+    out << "ACCESSOR";
+    break;
+
   case O_DEFINE: out << "O_DEFINE"; break;
   case O_LOOKUP: out << "O_LOOKUP"; break;
   case O_LAMBDA: out << "O_LAMBDA"; break;
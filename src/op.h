@@ -54,6 +54,10 @@ class expr_t::op_t : public noncopyable
 public:
   typedef expr_t::ptr_op_t ptr_op_t;
 
+  // An accessor is a built-in function of no arguments, which finds the
+  // object it applies to by searching the scope it is evaluated in.
+  typedef value_t (*accessor_t)(scope_t&);
+
 private:
   mutable short refc;
   ptr_op_t      left_;
@@ -63,6 +67,17 @@ private:
           string,               // used by constant IDENT
           expr_t::func_t        // used by terminal FUNCTION
           > data;
+  accessor_t    accessor;       // used by terminal ACCESSOR
+
+  // Subexpressions which occur more than once in a compiled expression
+  // are merged into a single node, which remembers the last value it
+  // computed.  That value is reused as long as the memo's generation is
+  // unchanged, which is to say for the duration of one call to
+  // expr_t::calc.
+  shared_ptr<expr_t::memo_t> memo;
+  std::size_t                memo_generation;
+  value_t::type_t            memo_context;
+  value_t                    memo_value;
 
 public:
   enum kind_t {
@@ -73,6 +88,7 @@ public:
     CONSTANTS,
 
     FUNCTION,
+    ACCESSOR,
 
     TERMINALS,
 
@@ -119,10 +135,14 @@ public:
 
   kind_t kind;
 
-  explicit op_t() : refc(0), kind(UNKNOWN) {
+  explicit op_t()
+    : refc(0), accessor(NULL), memo_generation(0),
+      memo_context(value_t::VOID), kind(UNKNOWN) {
     TRACE_CTOR(op_t, "");
   }
-  explicit op_t(const kind_t _kind) : refc(0), kind(_kind) {
+  explicit op_t(const kind_t _kind)
+    : refc(0), accessor(NULL), memo_generation(0),
+      memo_context(value_t::VOID), kind(_kind) {
     TRACE_CTOR(op_t, "const kind_t");
   }
   ~op_t() {
@@ -183,6 +203,17 @@ public:
     data = val;
   }
 
+  bool is_accessor() const {
+    return kind == ACCESSOR;
+  }
+  accessor_t as_accessor() const {
+    assert(kind == ACCESSOR);
+    return accessor;
+  }
+  void set_accessor(accessor_t val) {
+    accessor = val;
+  }
+
   ptr_op_t& left() {
     assert(kind > TERMINALS || kind == IDENT);
     return left_;
@@ -246,8 +277,10 @@ private:
 
   ptr_op_t copy(ptr_op_t _left = NULL, ptr_op_t _right = NULL) const {
     ptr_op_t node(new_node(kind, _left, _right));
-    if (kind < TERMINALS)
-      node->data = data;
+    if (kind < TERMINALS) {
+      node->data     = data;
+      node->accessor = accessor;
+    }
     return node;
   }
 
@@ -256,6 +289,9 @@ public:
                            ptr_op_t _right = NULL);
 
   ptr_op_t compile(scope_t& scope, const int depth = 0);
+  ptr_op_t merge_common(const shared_ptr<expr_t::memo_t>& memo_ptr,
+                        std::map<string, ptr_op_t>&        seen,
+                        string&                            signature);
   value_t  calc(scope_t& scope, ptr_op_t * locus = NULL,
                 const int depth = 0);
 
@@ -284,6 +320,7 @@ public:
 
   static ptr_op_t wrap_value(const value_t& val);
   static ptr_op_t wrap_functor(expr_t::func_t fobj);
+  static ptr_op_t wrap_accessor(accessor_t func);
 
 #if defined(HAVE_BOOST_SERIALIZATION)
 private:
@@ -295,7 +332,10 @@ private:
   void serialize(Archive& ar, const unsigned int /* version */) {
     ar & refc;
     ar & kind;
-    if (Archive::is_loading::value || ! left_ || left_->kind != FUNCTION) {
+    // Functions and accessors cannot be archived, so identifiers resolved
+    // to them are saved unresolved, and are looked up again when used.
+    if (Archive::is_loading::value || ! left_ ||
+        (left_->kind != FUNCTION && left_->kind != ACCESSOR)) {
       ar & left_;
     } else {
       ptr_op_t temp_op;
@@ -303,7 +343,8 @@ private:
     }
     if (Archive::is_loading::value || kind == VALUE || kind == IDENT ||
         (kind > UNARY_OPERATORS &&
-         (! has_right() || ! right()->is_function()))) {
+         (! has_right() ||
+          (! right()->is_function() && ! right()->is_accessor())))) {
       ar & data;
     } else {
       variant<ptr_op_t, value_t, string, expr_t::func_t> temp_data;
@@ -335,6 +376,13 @@ expr_t::op_t::wrap_functor(expr_t::func_t fobj) {
   return temp;
 }
 
+inline expr_t::ptr_op_t
+expr_t::op_t::wrap_accessor(accessor_t func) {
+  ptr_op_t temp(new op_t(op_t::ACCESSOR));
+  temp->set_accessor(func);
+  return temp;
+}
+
 #define MAKE_FUNCTOR(x) expr_t::op_t::wrap_functor(bind(&x, this, _1))
 #define WRAP_FUNCTOR(x) expr_t::op_t::wrap_functor(x)
 
@@ -77,6 +77,7 @@ public:
       name_len(other.name_len),
       ch(other.ch),
       handled(other.handled),
+      source(other.source),
       parent(NULL),
       value(other.value),
       wants_arg(other.wants_arg)
@@ -123,6 +124,12 @@ public:
     return handled;
   }
 
+  // An option turned on by its own constructor, rather than by the user,
+  // has no source.
+  const optional<string>& whence() const {
+    return source;
+  }
+
   string& str() {
     assert(handled);
     if (! value)
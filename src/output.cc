@@ -37,18 +37,44 @@
 #include "account.h"
 #include "session.h"
 #include "report.h"
+#include "filters.h"
 
 namespace ledger {
 
+void output_buffer_t::write()
+{
+  std::ostream& stream(out);
+  stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  buffer.clear();
+}
+
+void output_buffer_t::flush()
+{
+  write();
+  static_cast<std::ostream&>(out).flush();
+}
+
+string joined_note(const post_t& post)
+{
+  string note(post.note ? *post.note : empty_string);
+  if (post.xact->note)
+    note += *post.xact->note;
+  return note;
+}
+
 format_posts::format_posts(report_t&               _report,
                            const string&           format,
                            const optional<string>& _prepend_format,
                            std::size_t             _prepend_width)
   : report(_report), prepend_width(_prepend_width),
-    last_xact(NULL), last_post(NULL), first_report_title(true)
+    last_xact(NULL), last_post(NULL), first_report_title(true), jobs(1),
+    pending_failed(false)
 {
   TRACE_CTOR(format_posts, "report&, const string&, bool");
 
+  if (report.HANDLED(jobs_))
+    jobs = static_cast<std::size_t>(report.HANDLER(jobs_).value.to_long());
+
   const char * f = format.c_str();
 
   if (const char * p = std::strstr(f, "%/")) {
@@ -73,54 +99,395 @@ format_posts::format_posts(report_t&               _report,
 
 void format_posts::flush()
 {
+  format_pending();
   report.output_stream.flush();
 }
 
-void format_posts::operator()(post_t& post)
+void format_posts::format_post(std::ostream& out, const pending_post_t& entry)
 {
-  if (! post.has_xdata() ||
-      ! post.xdata().has_flags(POST_EXT_DISPLAYED)) {
-    std::ostream& out(report.output_stream);
+  bind_scope_t bound_scope(report, *entry.post);
 
-    bind_scope_t bound_scope(report, post);
+  if (! entry.title.empty()) {
+    if (entry.title_separator)
+      out << '\n';
 
-    if (! report_title.empty()) {
-      if (first_report_title)
-        first_report_title = false;
-      else
-        out << '\n';
+    value_scope_t val_scope(bound_scope, string_value(entry.title));
+    format_t group_title_format(report.HANDLER(group_title_format_).str());
 
-      value_scope_t val_scope(bound_scope, string_value(report_title));
-      format_t group_title_format(report.HANDLER(group_title_format_).str());
+    out << group_title_format(val_scope);
+  }
 
-      out << group_title_format(val_scope);
+  if (prepend_format) {
+    out.width(prepend_width);
+    out << prepend_format(bound_scope);
+  }
 
-      report_title = "";
-    }
+  if (entry.between_xact) {
+    bind_scope_t xact_scope(report, *entry.between_xact);
+    out << between_format(xact_scope);
+  }
 
-    if (prepend_format) {
-      out.width(prepend_width);
-      out << prepend_format(bound_scope);
+  if (entry.first_line)
+    out << first_line_format(bound_scope);
+  else
+    out << next_lines_format(bound_scope);
+}
+
+#if defined(HAVE_UNIX_PIPES)
+
+namespace {
+  struct format_worker_t
+  {
+    std::size_t begin;
+    std::size_t end;
+    pid_t       pid;
+    int         fd;
+  };
+
+  bool write_all(int fd, const string& text)
+  {
+    const char * p   = text.data();
+    std::size_t  len = text.length();
+    while (len > 0) {
+      ssize_t n = ::write(fd, p, len);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      p   += n;
+      len -= static_cast<std::size_t>(n);
     }
+    return true;
+  }
 
-    if (last_xact != post.xact) {
-      if (last_xact) {
-        bind_scope_t xact_scope(report, *last_xact);
-        out << between_format(xact_scope);
+  bool read_all(int fd, string& text)
+  {
+    char buf[65536];
+    for (;;) {
+      ssize_t n = ::read(fd, buf, sizeof(buf));
+      if (n == 0)
+        return true;
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
       }
-      out << first_line_format(bound_scope);
-      last_xact = post.xact;
+      text.append(buf, static_cast<std::size_t>(n));
     }
-    else if (last_post && last_post->date() != post.date()) {
-      out << first_line_format(bound_scope);
+  }
+}
+
+#endif // HAVE_UNIX_PIPES
+
+void format_posts::format_pending()
+{
+  std::ostream& out(report.output_stream);
+  std::size_t   done = 0;
+
+  // If a posting fails, those written before it are dropped from the
+  // queue, leaving the failing one first.
+  try {
+#if defined(HAVE_UNIX_PIPES)
+    // Expression evaluation and amount arithmetic share static state, so
+    // the postings are formatted by forked workers, each with its own
+    // copy of the report, rather than by threads.  Their output is
+    // joined in order; any slice whose worker could not be started or
+    // did not finish cleanly is formatted here instead, so errors are
+    // reported as usual.
+    if (pending.size() >= jobs * 16) {
+      std::vector<format_worker_t> workers;
+      std::size_t slice = (pending.size() + jobs - 1) / jobs;
+
+      out.flush();
+
+      for (std::size_t begin = 0; begin < pending.size(); begin += slice) {
+        format_worker_t worker;
+        worker.begin = begin;
+        worker.end   = std::min(begin + slice, pending.size());
+        worker.pid   = -1;
+        worker.fd    = -1;
+
+        int pfd[2];
+        if (pipe(pfd) == 0) {
+          worker.pid = fork();
+          if (worker.pid == 0) {
+            close(pfd[0]);
+
+            int status = 1;
+            try {
+              std::ostringstream buf;
+              buf.copyfmt(out);
+              for (std::size_t i = worker.begin; i < worker.end; i++)
+                format_post(buf, pending[i]);
+              if (write_all(pfd[1], buf.str()))
+                status = 0;
+            }
+            catch (...) {}
+
+            // Leave without running destructors or flushing any streams
+            // shared with the parent.
+            _exit(status);
+          }
+
+          close(pfd[1]);
+          if (worker.pid > 0)
+            worker.fd = pfd[0];
+          else
+            close(pfd[0]);
+        }
+        workers.push_back(worker);
+      }
+
+      // Collect every worker before writing anything, so that none is
+      // left running if formatting a failed slice here throws.
+      std::vector<optional<string> > results(workers.size());
+      for (std::size_t w = 0; w < workers.size(); w++) {
+        if (workers[w].pid <= 0)
+          continue;
+
+        string text;
+        bool   complete = read_all(workers[w].fd, text);
+        close(workers[w].fd);
+
+        int status = 0;
+        if (waitpid(workers[w].pid, &status, 0) == workers[w].pid &&
+            complete && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+          results[w] = text;
+      }
+
+      for (std::size_t w = 0; w < workers.size(); w++) {
+        if (results[w]) {
+          out << *results[w];
+          done = workers[w].end;
+        } else {
+          for (; done < workers[w].end; done++)
+            format_pending_post(out, pending[done]);
+        }
+      }
     }
-    else {
-      out << next_lines_format(bound_scope);
+#endif // HAVE_UNIX_PIPES
+
+    for (; done < pending.size(); done++)
+      format_pending_post(out, pending[done]);
+  }
+  catch (...) {
+    pending.erase(pending.begin(), pending.begin() + done);
+    throw;
+  }
+
+  pending.clear();
+}
+
+void format_posts::format_pending_post(std::ostream&         out,
+                                       const pending_post_t& entry)
+{
+  // Name the posting that was being handed down when this one arrived,
+  // as pass_down_posts would have when formatting it straight away.
+  // Postings that arrived while the chain was flushed, as sorted ones
+  // do, are named by nothing.
+  try {
+    format_post(out, entry);
+  }
+  catch (const std::exception&) {
+    if (entry.handed_down)
+      add_error_context(item_context(*entry.handed_down,
+                                     _("While handling posting")));
+    throw;
+  }
+}
+
+void format_posts::operator()(post_t& post)
+{
+  if (post.has_xdata() && post.xdata().has_flags(POST_EXT_DISPLAYED))
+    return;
+
+  pending_post_t entry;
+  entry.post            = &post;
+  entry.handed_down     = handed_down_post;
+  entry.between_xact    = NULL;
+  entry.first_line      = false;
+  entry.title_separator = false;
+
+  if (! report_title.empty()) {
+    if (first_report_title)
+      first_report_title = false;
+    else
+      entry.title_separator = true;
+
+    entry.title  = report_title;
+    report_title = "";
+  }
+
+  if (last_xact != post.xact) {
+    entry.between_xact = last_xact;
+    entry.first_line   = true;
+    last_xact          = post.xact;
+  }
+  else if (last_post && last_post->date() != post.date()) {
+    entry.first_line = true;
+  }
+
+  post.xdata().add_flags(POST_EXT_DISPLAYED);
+  last_post = &post;
+
+  if (jobs > 1) {
+    pending.push_back(entry);
+
+    // An error raised from here would go on to name the posting being
+    // handed down now as well, whatever posting actually failed.  So
+    // once one fails, the rest are only queued, and flush() formats it
+    // again to report the error.
+    if (pending.size() >= jobs * 4096 && ! pending_failed) {
+      try {
+        format_pending();
+      }
+      catch (const std::exception&) {
+        error_context();
+        pending_failed = true;
+      }
     }
+  } else {
+    format_post(report.output_stream, entry);
+  }
+}
+
+format_csv::format_csv(report_t&               _report,
+                       const optional<string>& _prepend_format,
+                       std::size_t             _prepend_width)
+  : report(_report), prepend_width(_prepend_width), first_report_title(true),
+    output(_report.output_stream)
+{
+  TRACE_CTOR(format_csv, "report&, const optional<string>&, std::size_t");
+
+  if (_prepend_format)
+    prepend_format.parse_format(*_prepend_format);
+}
 
-    post.xdata().add_flags(POST_EXT_DISPLAYED);
-    last_post = &post;
+void format_csv::write_quoted(const string& field, bool join_lines)
+{
+  output.buffer += '"';
+  foreach (const char ch, field) {
+    if (ch == '"')
+      output.buffer += "\\\"";
+    else if (ch == '\n' && join_lines)
+      output.buffer += "\\n";
+    else
+      output.buffer += ch;
   }
+  output.buffer += '"';
+}
+
+void format_csv::flush()
+{
+  output.flush();
+}
+
+void format_csv::write_row(post_t& post, const char *& column)
+{
+  bind_scope_t bound_scope(report, post);
+
+  if (! report_title.empty()) {
+    if (first_report_title)
+      first_report_title = false;
+    else
+      output.buffer += '\n';
+
+    value_scope_t val_scope(bound_scope, string_value(report_title));
+    format_t group_title_format(report.HANDLER(group_title_format_).str());
+
+    output.buffer += group_title_format(val_scope);
+
+    report_title = "";
+  }
+
+  if (prepend_format) {
+    std::ostringstream out;
+    out.width(prepend_width);
+    out << prepend_format(bound_scope);
+    output.buffer += out.str();
+  }
+
+  write_quoted(format_date(post.date(), FMT_WRITTEN));
+  output.buffer += ',';
+  write_quoted(post.xact->code ? *post.xact->code : empty_string);
+  output.buffer += ',';
+  write_quoted(post.payee());
+  output.buffer += ',';
+
+  string account(post.reported_account()->fullname());
+  if (post.has_flags(POST_VIRTUAL)) {
+    if (post.must_balance())
+      account = string("[") + account + "]";
+    else
+      account = string("(") + account + ")";
+  }
+  write_quoted(account);
+  output.buffer += ',';
+
+  column = "quoted(commodity)";
+  if (post.has_xdata() && post.xdata().has_flags(POST_EXT_COMPOUND))
+    write_quoted(post.xdata().compound_value.to_amount().commodity().symbol());
+  else
+    write_quoted(post.amount.commodity().symbol());
+  output.buffer += ',';
+
+  column = "quoted(quantity(scrub(display_amount)))";
+  value_t amount(report.display_value
+                 (report.HANDLER(display_amount_).expr.calc(bound_scope)));
+  write_quoted(value_t(amount.to_amount().number()).to_string());
+  output.buffer += ',';
+  column = NULL;
+
+  switch (post.state()) {
+  case item_t::CLEARED:
+    write_quoted("*");
+    break;
+  case item_t::PENDING:
+    write_quoted("!");
+    break;
+  default:
+    write_quoted(empty_string);
+    break;
+  }
+  output.buffer += ',';
+
+  write_quoted(joined_note(post), true);
+  output.buffer += '\n';
+}
+
+void format_csv::operator()(post_t& post)
+{
+  if (post.has_xdata() && post.xdata().has_flags(POST_EXT_DISPLAYED))
+    return;
+
+  // Should a column's value fail to compute, the rows before this one are
+  // still written, and the error names the column's expression from the
+  // default --csv-format, just as if that format had been used.
+  string::size_type row_start = output.buffer.size();
+  const char *      column    = NULL;
+  try {
+    write_row(post, column);
+  }
+  catch (const std::exception&) {
+    output.buffer.erase(row_start);
+    output.write();
+
+    if (column) {
+      string current_context = error_context();
+
+      add_error_context(_("While evaluating value expression:"));
+      add_error_context(string("  ") + column);
+
+      if (! current_context.empty())
+        add_error_context(current_context);
+    }
+    throw;
+  }
+
+  post.xdata().add_flags(POST_EXT_DISPLAYED);
+
+  output.write_if_full();
 }
 
 format_accounts::format_accounts(report_t&               _report,
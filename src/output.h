@@ -46,6 +46,7 @@
 #include "predicate.h"
 #include "format.h"
 #include "account.h"
+#include "stream.h"
 
 namespace ledger {
 
@@ -53,6 +54,41 @@ class xact_t;
 class post_t;
 class report_t;
 
+/**
+ * @brief Collects report text and writes it out in large pieces
+ *
+ * Handlers which build their lines by hand append to the buffer, and
+ * call write_if_full() after each line, so that the output stream sees
+ * only a few large writes however long the report is.
+ */
+class output_buffer_t : public noncopyable
+{
+  output_stream_t& out;
+
+public:
+  string buffer;
+
+  explicit output_buffer_t(output_stream_t& _out) : out(_out) {
+    TRACE_CTOR(output_buffer_t, "output_stream_t&");
+  }
+  ~output_buffer_t() {
+    TRACE_DTOR(output_buffer_t);
+  }
+
+  void write_if_full() {
+    if (buffer.size() >= 64 * 1024)
+      write();
+  }
+  void write();
+  void flush();
+};
+
+/**
+ * The note of a posting followed by that of its transaction, as the
+ * expression join(note | xact.note) gives it in the default formats.
+ */
+string joined_note(const post_t& post);
+
 class format_posts : public item_handler<post_t>
 {
 protected:
@@ -67,6 +103,29 @@ protected:
   bool        first_report_title;
   string      report_title;
 
+  // A posting ready to be formatted, along with what must be written
+  // around it.  These depend on the postings before it, so they are
+  // decided in order even when the formatting itself is not.  The
+  // posting being handed down when it arrived is the one an error in
+  // formatting it straight away would have named.
+  struct pending_post_t
+  {
+    post_t * post;
+    post_t * handed_down;
+    xact_t * between_xact;
+    bool     first_line;
+    bool     title_separator;
+    string   title;
+  };
+
+  std::size_t                 jobs;
+  std::vector<pending_post_t> pending;
+  bool                        pending_failed;
+
+  void format_post(std::ostream& out, const pending_post_t& entry);
+  void format_pending_post(std::ostream& out, const pending_post_t& entry);
+  void format_pending();
+
 public:
   format_posts(report_t& _report, const string& format,
                const optional<string>& _prepend_format = none,
@@ -86,7 +145,53 @@ public:
     last_xact    = NULL;
     last_post    = NULL;
 
+    report_title   = "";
+    pending.clear();
+    pending_failed = false;
+
+    item_handler<post_t>::clear();
+  }
+};
+
+/**
+ * @brief Write postings as CSV without going through a format string
+ *
+ * Produces exactly what the default --csv-format would, but takes each
+ * field straight from the posting and collects rows in one buffer that
+ * is written out in large pieces.  Only the display amount is still
+ * computed by expression, since it carries the valuation options.
+ */
+class format_csv : public item_handler<post_t>
+{
+protected:
+  report_t&       report;
+  format_t        prepend_format;
+  std::size_t     prepend_width;
+  bool            first_report_title;
+  string          report_title;
+  output_buffer_t output;
+
+  void write_quoted(const string& field, bool join_lines = false);
+  void write_row(post_t& post, const char *& column);
+
+public:
+  format_csv(report_t& _report,
+             const optional<string>& _prepend_format = none,
+             std::size_t _prepend_width = 0);
+  virtual ~format_csv() {
+    TRACE_DTOR(format_csv);
+  }
+
+  virtual void title(const string& str) {
+    report_title = str;
+  }
+
+  virtual void flush();
+  virtual void operator()(post_t& post);
+
+  virtual void clear() {
     report_title = "";
+    output.buffer.clear();
 
     item_handler<post_t>::clear();
   }
@@ -36,6 +36,7 @@
 #include "account.h"
 #include "journal.h"
 #include "format.h"
+#include "xdata.h"
 
 namespace ledger {
 
@@ -81,15 +82,17 @@ optional<value_t> post_t::get_tag(const mask_t& tag_mask,
 
 date_t post_t::value_date() const
 {
-  if (xdata_ && is_valid(xdata_->value_date))
-    return xdata_->value_date;
+  if (xdata_t * xd = find_xdata())
+    if (is_valid(xd->value_date))
+      return xd->value_date;
   return date();
 }
 
 date_t post_t::date() const
 {
-  if (xdata_ && is_valid(xdata_->date))
-    return xdata_->date;
+  if (xdata_t * xd = find_xdata())
+    if (is_valid(xd->date))
+      return xd->date;
 
   if (item_t::use_effective_date) {
     if (_date_eff)
@@ -107,8 +110,9 @@ date_t post_t::date() const
 
 date_t post_t::actual_date() const
 {
-  if (xdata_ && is_valid(xdata_->date))
-    return xdata_->date;
+  if (xdata_t * xd = find_xdata())
+    if (is_valid(xd->date))
+      return xd->date;
 
   if (! _date) {
     assert(xact);
@@ -246,8 +250,9 @@ namespace {
   }
 
   value_t get_total(post_t& post) {
-    if (post.xdata_ && ! post.xdata_->total.is_null())
-      return post.xdata_->total;
+    post_t::xdata_t * xd = post.find_xdata();
+    if (xd && ! xd->total.is_null())
+      return xd->total;
     else if (post.amount.is_null())
       return 0L;
     else
@@ -255,8 +260,8 @@ namespace {
   }
 
   value_t get_count(post_t& post) {
-    if (post.xdata_)
-      return long(post.xdata_->count);
+    if (post_t::xdata_t * xd = post.find_xdata())
+      return long(xd->count);
     else
       return 1L;
   }
@@ -350,11 +355,6 @@ namespace {
     return post.xdata().datetime;
   }
 
-  template <value_t (*Func)(post_t&)>
-  value_t get_wrapper(call_scope_t& scope) {
-    return (*Func)(find_scope<post_t>(scope));
-  }
-
   value_t fn_any(call_scope_t& args)
   {
     post_t& post(args.context<post_t>());
@@ -398,6 +398,49 @@ namespace {
     }
     return true;
   }
+
+  // This table must be kept in sorted order.
+  const builtin_t post_builtins[] = {
+    { "N",                  BUILTIN_ACCESSOR(post_t, get_count) },
+    { "O",                  BUILTIN_ACCESSOR(post_t, get_total) },
+    { "R",                  BUILTIN_ACCESSOR(post_t, get_real) },
+    { "a",                  BUILTIN_ACCESSOR(post_t, get_amount) },
+    { "account",            BUILTIN_FUNCTOR(get_account) },
+    { "account_base",       BUILTIN_ACCESSOR(post_t, get_account_base) },
+    { "account_id",         BUILTIN_ACCESSOR(post_t, get_account_id) },
+    { "all",                BUILTIN_FUNCTOR(fn_all) },
+    { "amount",             BUILTIN_ACCESSOR(post_t, get_amount) },
+    { "any",                BUILTIN_FUNCTOR(fn_any) },
+    { "b",                  BUILTIN_ACCESSOR(post_t, get_cost) },
+    { "calculated",         BUILTIN_ACCESSOR(post_t, get_is_calculated) },
+    { "code",               BUILTIN_ACCESSOR(post_t, get_code) },
+    { "commodity",          BUILTIN_FUNCTOR(get_commodity) },
+    { "cost",               BUILTIN_ACCESSOR(post_t, get_cost) },
+    { "cost_calculated",    BUILTIN_ACCESSOR(post_t, get_is_cost_calculated) },
+    { "count",              BUILTIN_ACCESSOR(post_t, get_count) },
+    { "datetime",           BUILTIN_ACCESSOR(post_t, get_datetime) },
+    { "depth",              BUILTIN_ACCESSOR(post_t, get_account_depth) },
+    { "display_account",    BUILTIN_FUNCTOR(get_display_account) },
+    { "has_cost",           BUILTIN_ACCESSOR(post_t, get_has_cost) },
+    { "id",                 BUILTIN_ACCESSOR(post_t, get_id) },
+    { "idstring",           BUILTIN_ACCESSOR(post_t, get_idstring) },
+    { "index",              BUILTIN_ACCESSOR(post_t, get_count) },
+    { "magnitude",          BUILTIN_ACCESSOR(post_t, get_magnitude) },
+    { "n",                  BUILTIN_ACCESSOR(post_t, get_count) },
+    { "note",               BUILTIN_ACCESSOR(post_t, get_note) },
+    { "parent",             BUILTIN_ACCESSOR(post_t, get_xact) },
+    { "payee",              BUILTIN_ACCESSOR(post_t, get_payee) },
+    { "post",               BUILTIN_ACCESSOR(post_t, get_this) },
+    { "primary",
+      BUILTIN_ACCESSOR(post_t, get_commodity_is_primary) },
+    { "real",               BUILTIN_ACCESSOR(post_t, get_real) },
+    { "total",              BUILTIN_ACCESSOR(post_t, get_total) },
+    { "use_direct_amount",  BUILTIN_ACCESSOR(post_t, get_use_direct_amount) },
+    { "value_date",         BUILTIN_ACCESSOR(post_t, get_value_date) },
+    { "virtual",            BUILTIN_ACCESSOR(post_t, get_virtual) },
+    { "xact",               BUILTIN_ACCESSOR(post_t, get_xact) },
+    { "xact_id",            BUILTIN_ACCESSOR(post_t, get_xact_id) },
+  };
 }
 
 expr_t::ptr_op_t post_t::lookup(const symbol_t::kind_t kind,
@@ -406,132 +449,8 @@ expr_t::ptr_op_t post_t::lookup(const symbol_t::kind_t kind,
   if (kind != symbol_t::FUNCTION)
     return item_t::lookup(kind, name);
 
-  switch (name[0]) {
-  case 'a':
-    if (name[1] == '\0' || name == "amount")
-      return WRAP_FUNCTOR(get_wrapper<&get_amount>);
-    else if (name == "account")
-      return WRAP_FUNCTOR(get_account);
-    else if (name == "account_base")
-      return WRAP_FUNCTOR(get_wrapper<&get_account_base>);
-    else if (name == "account_id")
-      return WRAP_FUNCTOR(get_wrapper<&get_account_id>);
-    else if (name == "any")
-      return WRAP_FUNCTOR(&fn_any);
-    else if (name == "all")
-      return WRAP_FUNCTOR(&fn_all);
-    break;
-
-  case 'b':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_cost>);
-    break;
-
-  case 'c':
-    if (name == "code")
-      return WRAP_FUNCTOR(get_wrapper<&get_code>);
-    else if (name == "cost")
-      return WRAP_FUNCTOR(get_wrapper<&get_cost>);
-    else if (name == "cost_calculated")
-      return WRAP_FUNCTOR(get_wrapper<&get_is_cost_calculated>);
-    else if (name == "count")
-      return WRAP_FUNCTOR(get_wrapper<&get_count>);
-    else if (name == "calculated")
-      return WRAP_FUNCTOR(get_wrapper<&get_is_calculated>);
-    else if (name == "commodity")
-      return WRAP_FUNCTOR(&get_commodity);
-    break;
-
-  case 'd':
-    if (name == "display_account")
-      return WRAP_FUNCTOR(get_display_account);
-    else if (name == "depth")
-      return WRAP_FUNCTOR(get_wrapper<&get_account_depth>);
-    else if (name == "datetime")
-      return WRAP_FUNCTOR(get_wrapper<&get_datetime>);
-    break;
-
-  case 'h':
-    if (name == "has_cost")
-      return WRAP_FUNCTOR(get_wrapper<&get_has_cost>);
-    break;
-
-  case 'i':
-    if (name == "index")
-      return WRAP_FUNCTOR(get_wrapper<&get_count>);
-    else if (name == "id")
-      return WRAP_FUNCTOR(get_wrapper<&get_id>);
-    else if (name == "idstring")
-      return WRAP_FUNCTOR(get_wrapper<&get_idstring>);
-    break;
-
-  case 'm':
-    if (name == "magnitude")
-      return WRAP_FUNCTOR(get_wrapper<&get_magnitude>);
-    break;
-
-  case 'n':
-    if (name == "note")
-      return WRAP_FUNCTOR(get_wrapper<&get_note>);
-    else if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_count>);
-    break;
-
-  case 'p':
-    if (name == "post")
-      return WRAP_FUNCTOR(get_wrapper<&get_this>);
-    else if (name == "payee")
-      return WRAP_FUNCTOR(get_wrapper<&get_payee>);
-    else if (name == "primary")
-      return WRAP_FUNCTOR(get_wrapper<&get_commodity_is_primary>);
-    else if (name == "parent")
-      return WRAP_FUNCTOR(get_wrapper<&get_xact>);
-    break;
-
-  case 'r':
-    if (name == "real")
-      return WRAP_FUNCTOR(get_wrapper<&get_real>);
-    break;
-
-  case 't':
-    if (name == "total")
-      return WRAP_FUNCTOR(get_wrapper<&get_total>);
-    break;
-
-  case 'u':
-    if (name == "use_direct_amount")
-      return WRAP_FUNCTOR(get_wrapper<&get_use_direct_amount>);
-    break;
-
-  case 'v':
-    if (name == "virtual")
-      return WRAP_FUNCTOR(get_wrapper<&get_virtual>);
-    else if (name == "value_date")
-      return WRAP_FUNCTOR(get_wrapper<&get_value_date>);
-    break;
-
-  case 'x':
-    if (name == "xact")
-      return WRAP_FUNCTOR(get_wrapper<&get_xact>);
-    else if (name == "xact_id")
-      return WRAP_FUNCTOR(get_wrapper<&get_xact_id>);
-    break;
-
-  case 'N':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_count>);
-    break;
-
-  case 'O':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_total>);
-    break;
-
-  case 'R':
-    if (name[1] == '\0')
-      return WRAP_FUNCTOR(get_wrapper<&get_real>);
-    break;
-  }
+  if (expr_t::ptr_op_t def = lookup_builtin(post_builtins, name))
+    return def;
 
   return item_t::lookup(kind, name);
 }
@@ -615,8 +534,9 @@ bool post_t::valid() const
 
 void post_t::add_to_value(value_t& value, const optional<expr_t&>& expr) const
 {
-  if (xdata_ && xdata_->has_flags(POST_EXT_COMPOUND)) {
-    add_or_set_value(value, xdata_->compound_value);
+  xdata_t * xd = find_xdata();
+  if (xd && xd->has_flags(POST_EXT_COMPOUND)) {
+    add_or_set_value(value, xd->compound_value);
   }
   else if (expr) {
     bind_scope_t bound_scope(*expr->get_context(),
@@ -632,15 +552,32 @@ void post_t::add_to_value(value_t& value, const optional<expr_t&>& expr) const
     add_or_set_value(value, xdata_->value);
 #endif
   }
-  else if (xdata_ && xdata_->has_flags(POST_EXT_VISITED) &&
-           ! xdata_->visited_value.is_null()) {
-    add_or_set_value(value, xdata_->visited_value);
+  else if (xd && xd->has_flags(POST_EXT_VISITED) &&
+           ! xd->visited_value.is_null()) {
+    add_or_set_value(value, xd->visited_value);
   }
   else {
     add_or_set_value(value, amount);
   }
 }
 
+post_t::xdata_t * post_t::table_xdata(bool create) const
+{
+  assert(current_xdata_table);
+  xdata_table_t::post_map& posts(current_xdata_table->posts);
+  if (create)
+    return &posts[this];
+
+  xdata_table_t::post_map::iterator i = posts.find(this);
+  return i != posts.end() ? &(*i).second : NULL;
+}
+
+void post_t::clear_table_xdata() const
+{
+  assert(current_xdata_table);
+  current_xdata_table->posts.erase(this);
+}
+
 void post_t::set_reported_account(account_t * account)
 {
   xdata().account = account;
@@ -736,9 +673,10 @@ void to_xml(std::ostream& out, const post_t& post)
     }
   }
 
-  if (post.xdata_ && ! post.xdata_->total.is_null()) {
+  post_t::xdata_t * xd = post.find_xdata();
+  if (xd && ! xd->total.is_null()) {
     push_xml y(out, "total");
-    to_xml(out, post.xdata_->total);
+    to_xml(out, xd->total);
   }
 }
 
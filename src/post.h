@@ -43,11 +43,11 @@
 #define _POST_H
 
 #include "item.h"
+#include "account.h"
 
 namespace ledger {
 
 class xact_t;
-class account_t;
 
 class post_t : public item_t
 {
@@ -94,9 +94,14 @@ public:
       xdata_(post.xdata_)
   {
     TRACE_CTOR(post_t, "copy");
+    if (current_xdata_table)
+      if (xdata_t * xd = post.find_xdata())
+        xdata() = *xd;
   }
   virtual ~post_t() {
     TRACE_DTOR(post_t);
+    if (current_xdata_table)
+      clear_xdata();
   }
 
   virtual string description() {
@@ -192,13 +197,26 @@ public:
   // moment.
   mutable optional<xdata_t> xdata_;
 
+  xdata_t * table_xdata(bool create) const;
+  void      clear_table_xdata() const;
+
+  xdata_t * find_xdata() const {
+    if (current_xdata_table)
+      return table_xdata(false);
+    return xdata_ ? &*xdata_ : NULL;
+  }
   bool has_xdata() const {
-    return xdata_;
+    return find_xdata() != NULL;
   }
   void clear_xdata() {
-    xdata_ = none;
+    if (current_xdata_table)
+      clear_table_xdata();
+    else
+      xdata_ = none;
   }
   xdata_t& xdata() {
+    if (current_xdata_table)
+      return *table_xdata(true);
     if (! xdata_)
       xdata_ = xdata_t();
     return *xdata_;
@@ -213,8 +231,8 @@ public:
   void set_reported_account(account_t * account);
 
   account_t * reported_account() {
-    if (xdata_)
-      if (account_t * acct = xdata_->account)
+    if (xdata_t * xd = find_xdata())
+      if (account_t * acct = xd->account)
         return acct;
     assert(account);
     return account;
@@ -34,7 +34,227 @@
 #include "predicate.h"
 #include "query.h"
 #include "op.h"
+#include "post.h"
+#include "account.h"
 
 namespace ledger {
 
+namespace {
+  void conjunction_terms(expr_t::ptr_op_t                op,
+                         std::list<expr_t::ptr_op_t>&    terms)
+  {
+    if (op->kind == expr_t::op_t::O_AND) {
+      conjunction_terms(op->left(), terms);
+      conjunction_terms(op->right(), terms);
+    } else {
+      terms.push_back(op);
+    }
+  }
+
+  bool is_mask_value(expr_t::ptr_op_t op)
+  {
+    return op && op->is_value() && op->as_value().is_mask();
+  }
+
+  bool native_term(expr_t::ptr_op_t         op,
+                   post_t&                  post,
+                   post_predicate_t::term_t& term)
+  {
+    if (op->kind == expr_t::op_t::O_NOT) {
+      term.negated = true;
+      op = op->left();
+    }
+
+    switch (op->kind) {
+    case expr_t::op_t::O_MATCH:
+      if (op->left()->is_ident() && is_mask_value(op->right())) {
+        if (op->left()->as_ident() == "account")
+          term.kind = post_predicate_t::term_t::ACCOUNT_MATCH;
+        else if (op->left()->as_ident() == "payee")
+          term.kind = post_predicate_t::term_t::PAYEE_MATCH;
+        else
+          return false;
+        term.mask = op->right()->as_value().as_mask();
+        return true;
+      }
+      break;
+
+    case expr_t::op_t::O_CALL:
+      if (op->left()->is_ident() &&
+          (op->left()->as_ident() == "has_tag" ||
+           op->left()->as_ident() == "has_meta")) {
+        expr_t::ptr_op_t args(op->right());
+        if (is_mask_value(args)) {
+          term.mask = args->as_value().as_mask();
+        }
+        else if (args && args->kind == expr_t::op_t::O_SEQ &&
+                 args->left()->kind == expr_t::op_t::O_CONS &&
+                 is_mask_value(args->left()->left()) &&
+                 is_mask_value(args->left()->right())) {
+          term.mask       = args->left()->left()->as_value().as_mask();
+          term.value_mask = args->left()->right()->as_value().as_mask();
+        }
+        else {
+          return false;
+        }
+        term.kind = post_predicate_t::term_t::HAS_TAG;
+        return true;
+      }
+      break;
+
+    case expr_t::op_t::O_EQ:
+    case expr_t::op_t::O_LT:
+    case expr_t::op_t::O_LTE:
+    case expr_t::op_t::O_GT:
+    case expr_t::op_t::O_GTE:
+      if (op->left()->is_ident() && op->right()->is_value()) {
+        // Postings resolve their own names before any other scope does,
+        // so whatever the posting answers here is what the expression
+        // would have used.
+        expr_t::ptr_op_t def =
+          post.lookup(symbol_t::FUNCTION, op->left()->as_ident());
+        if (def && def->is_accessor()) {
+          term.kind     = post_predicate_t::term_t::COMPARE;
+          term.compare  = op;
+          term.accessor = def->as_accessor();
+          return true;
+        }
+      }
+      break;
+
+    default:
+      break;
+    }
+    return false;
+  }
+}
+
+bool post_predicate_t::term_t::operator()(post_t& post)
+{
+  bool result = false;
+
+  switch (kind) {
+  case ACCOUNT_MATCH: {
+    account_t * account = post.reported_account();
+
+    // Temporary accounts are freed when the filter which made them is
+    // cleared, and a later one may be given the same address, so their
+    // matches are never remembered.
+    if (account->has_flags(ACCOUNT_TEMP)) {
+      result = mask.match(account->fullname());
+      break;
+    }
+
+    account_results_map::iterator i = account_results.find(account);
+    if (i != account_results.end()) {
+      result = (*i).second;
+    } else {
+      result = mask.match(account->fullname());
+      account_results.insert(account_results_map::value_type(account, result));
+    }
+    break;
+  }
+
+  case PAYEE_MATCH:
+    result = mask.match(post.payee());
+    break;
+
+  case HAS_TAG:
+    result = post.has_tag(mask, value_mask);
+    break;
+
+  case COMPARE: {
+    value_t        lhs((*accessor)(post));
+    const value_t& rhs(compare->right()->as_value());
+
+    switch (compare->kind) {
+    case expr_t::op_t::O_EQ:  result = lhs == rhs; break;
+    case expr_t::op_t::O_LT:  result = lhs <  rhs; break;
+    case expr_t::op_t::O_LTE: result = lhs <= rhs; break;
+    case expr_t::op_t::O_GT:  result = lhs >  rhs; break;
+    case expr_t::op_t::O_GTE: result = lhs >= rhs; break;
+    default:
+      assert(false);
+      break;
+    }
+    break;
+  }
+  }
+
+  return negated ? ! result : result;
+}
+
+void post_predicate_t::compile(scope_t& scope)
+{
+  if (compiled)
+    return;
+
+  if (ptr && ! original) {
+    if (post_t * post = search_scope<post_t>(&scope)) {
+      std::list<ptr_op_t> conjuncts;
+      conjunction_terms(ptr, conjuncts);
+
+      // Only the leading terms can be tested natively, since the rest of
+      // the expression must not be calculated for postings which they
+      // reject.
+      while (! conjuncts.empty()) {
+        term_t term;
+        if (! native_term(conjuncts.front(), *post, term))
+          break;
+        terms.push_back(term);
+        conjuncts.pop_front();
+      }
+
+      if (! terms.empty()) {
+        original = ptr;
+        ptr      = NULL;
+        foreach (ptr_op_t conjunct, conjuncts) {
+          if (ptr)
+            ptr = expr_t::op_t::new_node(expr_t::op_t::O_AND, ptr, conjunct);
+          else
+            ptr = conjunct;
+        }
+        DEBUG("predicate.native",
+              "Testing " << terms.size() << " term(s) natively in: " << str);
+      }
+    }
+  }
+
+  if (ptr)
+    predicate_t::compile(scope);
+  else
+    compiled = true;
+}
+
+value_t post_predicate_t::real_calc(scope_t& scope)
+{
+  if (! terms.empty()) {
+    post_t * post = search_scope<post_t>(&scope);
+    if (! post)
+      throw_(std::runtime_error, _("Could not find scope"));
+
+    foreach (term_t& term, terms) {
+      try {
+        if (! term(*post))
+          return false;
+      }
+      catch (const std::exception&) {
+        // Report the failure just as the generic evaluator would have,
+        // pointing at the comparison within the original expression.
+        if (term.kind == term_t::COMPARE) {
+          string current_context = error_context();
+
+          add_error_context(_("While evaluating value expression:"));
+          add_error_context(op_context(original, term.compare));
+
+          if (! current_context.empty())
+            add_error_context(current_context);
+        }
+        throw;
+      }
+    }
+  }
+  return predicate_t::real_calc(scope);
+}
+
 } // namespace ledger
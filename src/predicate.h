@@ -105,6 +105,92 @@ private:
 #endif // HAVE_BOOST_SERIALIZATION
 };
 
+class post_t;
+class account_t;
+
+/**
+ * @brief A predicate which is only ever applied to postings.
+ *
+ * When it is compiled, the leading terms of the predicate's conjunction
+ * which have a common shape -- the account or payee matched against a
+ * mask, a test for a tag, or a posting value compared with a constant --
+ * are taken out of the expression and tested directly against the
+ * posting.  Only the remaining terms are calculated by the expression
+ * evaluator.  Account matches are remembered for each account until the
+ * predicate is next marked uncompiled.
+ */
+class post_predicate_t : public predicate_t
+{
+public:
+  struct term_t
+  {
+    enum kind_t {
+      ACCOUNT_MATCH,
+      PAYEE_MATCH,
+      HAS_TAG,
+      COMPARE
+    } kind;
+
+    bool             negated;
+    mask_t           mask;
+    optional<mask_t> value_mask;
+    ptr_op_t         compare;
+    value_t       (* accessor)(scope_t&);
+
+    // The outcome of an ACCOUNT_MATCH depends on nothing but the account,
+    // so it is only worked out once for each account that lasts as long
+    // as the journal.
+    typedef std::map<account_t *, bool> account_results_map;
+
+    account_results_map account_results;
+
+    term_t() : kind(ACCOUNT_MATCH), negated(false), accessor(NULL) {
+      TRACE_CTOR(post_predicate_t::term_t, "");
+    }
+    term_t(const term_t& other)
+      : kind(other.kind), negated(other.negated), mask(other.mask),
+        value_mask(other.value_mask), compare(other.compare),
+        accessor(other.accessor), account_results(other.account_results) {
+      TRACE_CTOR(post_predicate_t::term_t, "copy");
+    }
+    ~term_t() throw() {
+      TRACE_DTOR(post_predicate_t::term_t);
+    }
+
+    bool operator()(post_t& post);
+  };
+
+  typedef std::list<term_t> terms_list;
+
+protected:
+  ptr_op_t   original;
+  terms_list terms;
+
+public:
+  post_predicate_t(const predicate_t& predicate) : predicate_t(predicate) {
+    TRACE_CTOR(post_predicate_t, "predicate_t");
+  }
+  post_predicate_t(const post_predicate_t& other)
+    : predicate_t(other), original(other.original), terms(other.terms) {
+    TRACE_CTOR(post_predicate_t, "copy");
+  }
+  virtual ~post_predicate_t() {
+    TRACE_DTOR(post_predicate_t);
+  }
+
+  virtual void    compile(scope_t& scope);
+  virtual value_t real_calc(scope_t& scope);
+
+  virtual void mark_uncompiled() {
+    if (original) {
+      ptr = original;
+      original = NULL;
+    }
+    terms.clear();
+    predicate_t::mark_uncompiled();
+  }
+};
+
 } // namespace ledger
 
 #endif // _PREDICATE_H
@@ -35,6 +35,7 @@
 #include "pyutils.h"
 #include "account.h"
 #include "post.h"
+#include "xdata.h"
 
 namespace ledger {
 
@@ -87,8 +88,31 @@ namespace {
     return journal.find_account(name, auto_create);
   }
 
-  account_t::xdata_t& py_xdata(account_t& account) {
-    return account.xdata();
+  // An account handed out by a collection reads the extended data that
+  // the collection's report left for it.
+
+  bool py_has_xdata(object self) {
+    account_t&      item = extract<account_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+
+    xdata_binding_t binding(table);
+    return item.has_xdata();
+  }
+
+  void py_clear_xdata(object self) {
+    account_t&      item = extract<account_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+
+    xdata_binding_t binding(table);
+    item.clear_xdata();
+  }
+
+  account_t::xdata_t& py_xdata(object self) {
+    account_t&      item = extract<account_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+
+    xdata_binding_t binding(table);
+    return item.xdata();
   }
 
   PyObject * py_account_unicode(account_t& account) {
@@ -214,8 +238,8 @@ void export_account()
     .def("posts", python::range<return_internal_reference<> >
          (&account_t::posts_begin, &account_t::posts_end))
 
-    .def("has_xdata", &account_t::has_xdata)
-    .def("clear_xdata", &account_t::clear_xdata)
+    .def("has_xdata", py_has_xdata)
+    .def("clear_xdata", py_clear_xdata)
     .def("xdata", py_xdata,
          return_internal_reference<>())
 
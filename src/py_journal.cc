@@ -34,6 +34,7 @@
 #include "pyinterp.h"
 #include "pyutils.h"
 #include "journal.h"
+#include "pool.h"
 #include "xact.h"
 #include "post.h"
 #include "chain.h"
@@ -41,6 +42,7 @@
 #include "iterators.h"
 #include "scope.h"
 #include "report.h"
+#include "xdata.h"
 
 namespace ledger {
 
@@ -136,18 +138,46 @@ namespace {
     return journal.read(pathname);
   }
 
+  // The number of collections and streams open on each journal.  They
+  // and the postings they hand out point into the journal's xacts, which
+  // refresh() may delete.
+  std::map<const journal_t *, std::size_t> open_collections;
+
+  bool py_refresh(journal_t& journal)
+  {
+    std::map<const journal_t *, std::size_t>::const_iterator i =
+      open_collections.find(&journal);
+    if (i != open_collections.end() && (*i).second > 0) {
+      PyErr_SetString(PyExc_RuntimeError,
+                      _("Cannot refresh a journal while results of "
+                        "collect() or query() are still in use"));
+      throw_error_already_set();
+    }
+
+    return journal.refresh();
+  }
+
   struct collector_wrapper
   {
     journal_t&       journal;
     report_t         report;
+    xdata_table_t    xdata;
     collect_posts *  posts_collector;
     post_handler_ptr chain;
 
     collector_wrapper(journal_t& _journal, report_t& base)
       : journal(_journal), report(base),
-        posts_collector(new collect_posts) {}
+        posts_collector(new collect_posts) {
+      open_collections[&journal]++;
+    }
     ~collector_wrapper() {
-      journal.clear_xdata();
+      {
+        // Temporaries made by the chain must drop their own table entries.
+        xdata_binding_t binding(xdata);
+        chain.reset();
+      }
+      if (--open_collections[&journal] == 0)
+        open_collections.erase(&journal);
     }
 
     std::size_t length() const {
@@ -162,46 +192,179 @@ namespace {
     }
   };
 
-  shared_ptr<collector_wrapper>
-  py_collect(journal_t& journal, const string& query)
+  // Report code reaches the journal through the session, so the journal
+  // being queried stands in for the session's own while a collection is
+  // set up or advanced.
+  struct session_journal_t : public noncopyable
   {
-    if (journal.has_xdata()) {
-      PyErr_SetString(PyExc_RuntimeError,
-                      _("Cannot have multiple journal collections open at once"));
-      throw_error_already_set();
+    report_t&             report;
+    unique_ptr<journal_t> saved;
+
+    session_journal_t(report_t& _report, journal_t& journal)
+      : report(_report), saved(report.session.journal.release()) {
+      report.session.journal.reset(&journal);
+    }
+    ~session_journal_t() {
+      report.session.journal.release();
+      report.session.journal.reset(saved.release());
     }
+  };
+
+  void start_collection(collector_wrapper& coll, const string& query)
+  {
+    strings_list remaining =
+      process_arguments(split_arguments(query.c_str()), coll.report);
+    coll.report.normalize_options("register");
 
+    value_t args;
+    foreach (const string& arg, remaining)
+      args.push_back(string_value(arg));
+    coll.report.parse_query_args(args, "@Journal.collect");
+
+    coll.chain = chain_post_handlers(post_handler_ptr(coll.posts_collector),
+                                     coll.report);
+  }
+
+  shared_ptr<collector_wrapper>
+  py_collect(journal_t& journal, const string& query)
+  {
     report_t& current_report(downcast<report_t>(*scope_t::default_scope));
     shared_ptr<collector_wrapper> coll(new collector_wrapper(journal,
                                                              current_report));
-    unique_ptr<journal_t> save_journal(current_report.session.journal.release());
-    current_report.session.journal.reset(&journal);
-
-    try {
-      strings_list remaining =
-        process_arguments(split_arguments(query.c_str()), coll->report);
-      coll->report.normalize_options("register");
-
-      value_t args;
-      foreach (const string& arg, remaining)
-        args.push_back(string_value(arg));
-      coll->report.parse_query_args(args, "@Journal.collect");
-
-      journal_posts_iterator walker(coll->journal);
-      coll->chain =
-        chain_post_handlers(post_handler_ptr(coll->posts_collector),
-                            coll->report);
-      pass_down_posts<journal_posts_iterator>(coll->chain, walker);
+
+    session_journal_t session_journal(current_report, journal);
+    xdata_binding_t   binding(coll->xdata);
+
+    start_collection(*coll, query);
+
+    journal_posts_iterator walker(coll->journal);
+    pass_down_posts<journal_posts_iterator>(coll->chain, walker);
+
+    return coll;
+  }
+
+  /**
+   * A collection which runs its chain only as far as its reader needs:
+   * postings are fed in from the journal one at a time until the chain
+   * lets something through, so the first results arrive without waiting
+   * for the whole report, and only postings not yet read are held.
+   * Handlers that must see everything before they emit (sorting,
+   * subtotals) still do so on the final flush.
+   */
+  struct post_stream_t : public collector_wrapper
+  {
+    journal_posts_iterator walker;
+    std::size_t            position;
+    bool                   flushed;
+
+    post_stream_t(journal_t& _journal, report_t& _base)
+      : collector_wrapper(_journal, _base), position(0), flushed(false) {}
+
+    post_t * next() {
+      std::vector<post_t *>& posts(posts_collector->posts);
+
+      while (position == posts.size()) {
+        if (flushed)
+          return NULL;
+
+        posts.clear();
+        position = 0;
+
+        if (post_t * post = *walker++) {
+          try {
+            (*chain)(*post);
+          }
+          catch (const std::exception&) {
+            add_error_context(item_context(*post, _("While handling posting")));
+            throw;
+          }
+        } else {
+          chain->flush();
+          flushed = true;
+        }
+      }
+      return posts[position++];
     }
-    catch (...) {
-      current_report.session.journal.release();
-      current_report.session.journal.reset(save_journal.release());
-      throw;
+  };
+
+  shared_ptr<post_stream_t>
+  py_query(journal_t& journal, const string& query)
+  {
+    report_t& current_report(downcast<report_t>(*scope_t::default_scope));
+    shared_ptr<post_stream_t> stream(new post_stream_t(journal,
+                                                       current_report));
+
+    session_journal_t session_journal(current_report, journal);
+    xdata_binding_t   binding(stream->xdata);
+
+    start_collection(*stream, query);
+    stream->walker.reset(journal);
+
+    return stream;
+  }
+
+  post_t * stream_next(post_stream_t& stream)
+  {
+    session_journal_t session_journal(stream.report, stream.journal);
+    xdata_binding_t   binding(stream.xdata);
+
+    return stream.next();
+  }
+
+  object py_stream_next(object self)
+  {
+    post_t * post = stream_next(extract<post_stream_t&>(self));
+    if (! post) {
+      PyErr_SetString(PyExc_StopIteration, _("No more postings"));
+      throw_error_already_set();
     }
-    current_report.session.journal.release();
-    current_report.session.journal.reset(save_journal.release());
+    return collected_item(self, object(ptr(post)));
+  }
 
-    return coll;
+  // Each posting in a batch keeps the stream alive, as next()'s does.
+  python::list py_stream_batch(object self, long size)
+  {
+    if (size < 0) {
+      PyErr_SetString(PyExc_ValueError,
+                      _("Batch size must not be negative"));
+      throw_error_already_set();
+    }
+
+    post_stream_t&        stream = extract<post_stream_t&>(self);
+    std::vector<post_t *> batch;
+    {
+      session_journal_t session_journal(stream.report, stream.journal);
+      xdata_binding_t   binding(stream.xdata);
+
+      while (batch.size() < static_cast<std::size_t>(size))
+        if (post_t * post = stream.next())
+          batch.push_back(post);
+        else
+          break;
+    }
+
+    python::list posts;
+    foreach (post_t * post, batch)
+      posts.append(collected_item(self, object(ptr(post))));
+    return posts;
+  }
+
+  object py_stream_iter(object stream)
+  {
+    return stream;
+  }
+
+  post_t::xdata_t& stream_xdata(post_stream_t& stream, post_t& post)
+  {
+    xdata_binding_t binding(&stream.xdata);
+    return post.xdata();
+  }
+
+  account_t::xdata_t& stream_account_xdata(post_stream_t& stream,
+                                           account_t& account)
+  {
+    xdata_binding_t binding(&stream.xdata);
+    return account.xdata();
   }
 
   post_t * posts_getitem(collector_wrapper& collector, long i)
@@ -214,8 +377,308 @@ namespace {
     return post;
   }
 
+  object collector_getitem(object self, long i)
+  {
+    return collected_item
+      (self, object(ptr(posts_getitem(extract<collector_wrapper&>(self), i))));
+  }
+
+  // Iterates over a collection, handing out its postings as it does.
+  struct collector_iterator_t
+  {
+    object      collection;
+    std::size_t position;
+
+    collector_iterator_t(const object& _collection)
+      : collection(_collection), position(0) {}
+  };
+
+  object collector_iter(object self)
+  {
+    return object(collector_iterator_t(self));
+  }
+
+  object collector_iterator_next(collector_iterator_t& iter)
+  {
+    collector_wrapper& collector(extract<collector_wrapper&>(iter.collection));
+    if (iter.position == collector.length()) {
+      PyErr_SetString(PyExc_StopIteration, _("No more postings"));
+      throw_error_already_set();
+    }
+    post_t * post = collector.posts_collector->posts[iter.position++];
+    return collected_item(iter.collection, object(ptr(post)));
+  }
+
+  post_t::xdata_t& collector_xdata(collector_wrapper& collector,
+                                   post_t& post)
+  {
+    xdata_binding_t binding(&collector.xdata);
+    return post.xdata();
+  }
+
+  account_t::xdata_t& collector_account_xdata(collector_wrapper& collector,
+                                              account_t& account)
+  {
+    xdata_binding_t binding(&collector.xdata);
+    return account.xdata();
+  }
+
+  /**
+   * A read-only, contiguous column of values which Python reaches through
+   * the buffer protocol, so numpy.asarray() or memoryview() read it in
+   * place without wrapping each element.
+   */
+  template <typename T>
+  struct column_t : public noncopyable
+  {
+    static const char * format;
+
+    std::vector<T> values;
+    Py_ssize_t     length;
+    Py_ssize_t     stride;
+
+    column_t() : length(0), stride(sizeof(T)) {}
+
+    void push_back(const T& value) {
+      values.push_back(value);
+      length++;
+    }
+    std::size_t size() const {
+      return values.size();
+    }
+  };
+
+  template <> const char * column_t<boost::int32_t>::format = "i";
+  template <> const char * column_t<boost::int64_t>::format = "q";
+  template <> const char * column_t<double>::format         = "d";
+
+  template <typename T>
+  int column_getbuffer(PyObject * obj, Py_buffer * view, int flags)
+  {
+    extract<column_t<T>&> extracted(obj);
+    if (! extracted.check()) {
+      view->obj = NULL;
+      PyErr_SetString(PyExc_TypeError, _("Not a ledger column"));
+      return -1;
+    }
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+      view->obj = NULL;
+      PyErr_SetString(PyExc_BufferError, _("Ledger columns are read-only"));
+      return -1;
+    }
+
+    static T empty;
+    column_t<T>& column(extracted());
+
+    Py_INCREF(obj);
+    view->obj        = obj;
+    view->buf        = column.values.empty() ? &empty : &column.values[0];
+    view->len        = column.length * column.stride;
+    view->readonly   = 1;
+    view->itemsize   = column.stride;
+    view->format     = ((flags & PyBUF_FORMAT) == PyBUF_FORMAT ?
+                        const_cast<char *>(column_t<T>::format) : NULL);
+    view->ndim       = 1;
+    view->shape      = ((flags & PyBUF_ND) == PyBUF_ND ?
+                        &column.length : NULL);
+    view->strides    = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES ?
+                        &column.stride : NULL);
+    view->suboffsets = NULL;
+    view->internal   = NULL;
+    return 0;
+  }
+
+  template <typename T>
+  void export_column(const char * name)
+  {
+    static PyBufferProcs procs;
+    procs.bf_getbuffer = column_getbuffer<T>;
+
+    object type_object =
+      class_< column_t<T>, boost::noncopyable >(name, no_init)
+        .def("__len__", &column_t<T>::size)
+      ;
+
+    PyTypeObject * type = reinterpret_cast<PyTypeObject *>(type_object.ptr());
+    type->tp_as_buffer = &procs;
+#if defined(Py_TPFLAGS_HAVE_NEWBUFFER)
+    type->tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+  }
+
+  /**
+   * The postings of a query laid out column by column.  Accounts, payees
+   * and commodities are stored as indexes into the matching string
+   * tables.  A quantity is the amount scaled by 10^scale of its
+   * commodity; when that is not an exact integer the quantity holds
+   * INEXACT and only quantity_float is meaningful.
+   */
+  struct post_columns_t : public noncopyable
+  {
+    static const boost::int64_t INEXACT;
+
+    column_t<boost::int32_t> date;      // days since 1970-01-01
+    column_t<boost::int32_t> account;
+    column_t<boost::int32_t> payee;
+    column_t<boost::int32_t> commodity;
+    column_t<boost::int64_t> quantity;
+    column_t<double>         quantity_float;
+
+    std::vector<string>                accounts;
+    std::vector<string>                payees;
+    std::vector<string>                commodities;
+    std::vector<amount_t::precision_t> scales;
+
+    std::map<account_t *, boost::int32_t>   account_ids;
+    std::map<string, boost::int32_t>        payee_ids;
+    std::map<commodity_t *, boost::int32_t> commodity_ids;
+
+    boost::int32_t account_id(account_t * acct) {
+      std::map<account_t *, boost::int32_t>::iterator i =
+        account_ids.find(acct);
+      if (i != account_ids.end())
+        return (*i).second;
+
+      boost::int32_t id = static_cast<boost::int32_t>(accounts.size());
+      accounts.push_back(acct->fullname());
+      account_ids.insert(std::pair<account_t *, boost::int32_t>(acct, id));
+      return id;
+    }
+
+    boost::int32_t payee_id(const string& name) {
+      std::map<string, boost::int32_t>::iterator i = payee_ids.find(name);
+      if (i != payee_ids.end())
+        return (*i).second;
+
+      boost::int32_t id = static_cast<boost::int32_t>(payees.size());
+      payees.push_back(name);
+      payee_ids.insert(std::pair<string, boost::int32_t>(name, id));
+      return id;
+    }
+
+    boost::int32_t commodity_id(commodity_t& comm) {
+      std::map<commodity_t *, boost::int32_t>::iterator i =
+        commodity_ids.find(&comm);
+      if (i != commodity_ids.end())
+        return (*i).second;
+
+      boost::int32_t id = static_cast<boost::int32_t>(commodities.size());
+      commodities.push_back(comm.symbol());
+      scales.push_back(comm.precision());
+      commodity_ids.insert(std::pair<commodity_t *, boost::int32_t>(&comm, id));
+      return id;
+    }
+
+    std::size_t column_length() const {
+      return date.size();
+    }
+
+    void add_post(post_t& post);
+  };
+
+  const boost::int64_t post_columns_t::INEXACT =
+    std::numeric_limits<boost::int64_t>::min();
+
+  void post_columns_t::add_post(post_t& post)
+  {
+    static const date_t epoch(1970, 1, 1);
+
+    date.push_back(static_cast<boost::int32_t>((post.date() - epoch).days()));
+    account.push_back(account_id(post.reported_account()));
+    payee.push_back(payee_id(post.payee()));
+
+    if (post.amount.is_null()) {
+      commodity.push_back(commodity_id(*commodity_pool_t::current_pool->
+                                       null_commodity));
+      quantity.push_back(0);
+      quantity_float.push_back(0.0);
+      return;
+    }
+
+    boost::int32_t id = commodity_id(post.amount.commodity());
+    commodity.push_back(id);
+
+    amount_t number(post.amount.number());
+    quantity_float.push_back(number.to_double());
+
+    // The scaled quantity must fit in a long, which limits it to 32 bits
+    // on platforms where long is that narrow.
+    boost::int64_t scaled_quantity = INEXACT;
+    if (scales[id] <= std::numeric_limits<long>::digits10) {
+      long factor = 1;
+      for (amount_t::precision_t i = 0; i < scales[id]; i++)
+        factor *= 10;
+
+      amount_t scaled(number * amount_t(factor));
+      if (scaled == scaled.floored() && scaled.fits_in_long())
+        scaled_quantity = scaled.to_long();
+    }
+    quantity.push_back(scaled_quantity);
+  }
+
+  shared_ptr<post_columns_t>
+  py_columns(journal_t& journal, const string& query)
+  {
+    shared_ptr<collector_wrapper> coll(py_collect(journal, query));
+    shared_ptr<post_columns_t>    columns(new post_columns_t);
+
+    xdata_binding_t binding(coll->xdata);
+
+    foreach (post_t * post, coll->posts_collector->posts)
+      columns->add_post(*post);
+
+    return columns;
+  }
+
+  python::list string_table(const std::vector<string>& strings)
+  {
+    python::list table;
+    foreach (const string& str, strings)
+      table.append(str);
+    return table;
+  }
+
+  python::list py_column_accounts(post_columns_t& columns) {
+    return string_table(columns.accounts);
+  }
+  python::list py_column_payees(post_columns_t& columns) {
+    return string_table(columns.payees);
+  }
+  python::list py_column_commodities(post_columns_t& columns) {
+    return string_table(columns.commodities);
+  }
+  python::list py_column_scales(post_columns_t& columns) {
+    python::list table;
+    foreach (amount_t::precision_t scale, columns.scales)
+      table.append(scale);
+    return table;
+  }
+
 } // unnamed namespace
 
+object collected_item(const object& collection, const object& item)
+{
+  object result(item);
+  if (! collection.is_none() && ! result.is_none())
+    result.attr("_collection") = collection;
+  return result;
+}
+
+xdata_table_t * collection_xdata(const object& item)
+{
+  object collection(getattr(item, "_collection", object()));
+  if (collection.is_none())
+    return NULL;
+
+  extract<collector_wrapper&> collector(collection);
+  if (collector.check())
+    return &collector().xdata;
+  extract<post_stream_t&> stream(collection);
+  if (stream.check())
+    return &stream().xdata;
+  return NULL;
+}
+
 void export_journal()
 {
   class_< item_handler<post_t>, shared_ptr<item_handler<post_t> >,
@@ -233,14 +696,55 @@ void export_journal()
   class_< collector_wrapper, shared_ptr<collector_wrapper>,
           boost::noncopyable >("PostCollectorWrapper", no_init)
     .def("__len__", &collector_wrapper::length)
-    .def("__getitem__", posts_getitem, return_internal_reference<1,
-                             with_custodian_and_ward_postcall<0, 1> >())
-    .def("__iter__",
-         python::range<return_value_policy<reference_existing_object,
-                       with_custodian_and_ward_postcall<0, 1> > >
-         (&collector_wrapper::begin, &collector_wrapper::end))
+    .def("__getitem__", collector_getitem)
+    .def("__iter__", collector_iter)
+    .def("xdata", collector_xdata, return_internal_reference<1>())
+    .def("xdata", collector_account_xdata, return_internal_reference<1>())
     ;
 
+  class_< collector_iterator_t >("PostCollectorIterator", no_init)
+    .def("__iter__", py_stream_iter)
+    .def("next", collector_iterator_next)
+    .def("__next__", collector_iterator_next)
+    ;
+
+  class_< post_stream_t, shared_ptr<post_stream_t>,
+          boost::noncopyable >("PostStream", no_init)
+    .def("__iter__", py_stream_iter)
+    .def("next", py_stream_next)
+    .def("__next__", py_stream_next)
+    .def("batch", py_stream_batch)
+    .def("xdata", stream_xdata, return_internal_reference<1>())
+    .def("xdata", stream_account_xdata, return_internal_reference<1>())
+    ;
+
+  export_column<boost::int32_t>("Int32Column");
+  export_column<boost::int64_t>("Int64Column");
+  export_column<double>("Float64Column");
+
+#define EXPORT_COLUMN(name)                                             \
+  .add_property(#name,                                                  \
+                make_getter(&post_columns_t::name,                      \
+                            return_internal_reference<1>()))
+
+  class_< post_columns_t, shared_ptr<post_columns_t>,
+          boost::noncopyable >("PostColumns", no_init)
+    .def("__len__", &post_columns_t::column_length)
+    EXPORT_COLUMN(date)
+    EXPORT_COLUMN(account)
+    EXPORT_COLUMN(payee)
+    EXPORT_COLUMN(commodity)
+    EXPORT_COLUMN(quantity)
+    EXPORT_COLUMN(quantity_float)
+    .add_property("accounts", py_column_accounts)
+    .add_property("payees", py_column_payees)
+    .add_property("commodities", py_column_commodities)
+    .add_property("scales", py_column_scales)
+    .setattr("INEXACT", post_columns_t::INEXACT)
+    ;
+
+#undef EXPORT_COLUMN
+
   class_< journal_t::fileinfo_t > ("FileInfo")
     .def(init<path>())
 
@@ -308,11 +812,14 @@ void export_journal()
          (&journal_t::sources_begin, &journal_t::sources_end))
 
     .def("read", py_read)
+    .def("refresh", py_refresh)
 
     .def("has_xdata", &journal_t::has_xdata)
     .def("clear_xdata", &journal_t::clear_xdata)
 
     .def("collect", py_collect, with_custodian_and_ward_postcall<0, 1>())
+    .def("columns", py_columns)
+    .def("query", py_query, with_custodian_and_ward_postcall<0, 1>())
 
     .def("valid", &journal_t::valid)
     ;
@@ -34,6 +34,7 @@
 #include "pyinterp.h"
 #include "post.h"
 #include "xact.h"
+#include "xdata.h"
 
 namespace ledger {
 
@@ -63,12 +64,57 @@ namespace {
     return post.get_tag(tag_mask, value_mask);
   }
 
-  post_t::xdata_t& py_xdata(post_t& post) {
-    return post.xdata();
+  // A posting handed out by a collection reads the extended data that
+  // the collection's report left for it.
+
+  bool py_has_xdata(object self) {
+    post_t&         item = extract<post_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+
+    xdata_binding_t binding(table);
+    return item.has_xdata();
+  }
+
+  void py_clear_xdata(object self) {
+    post_t&         item = extract<post_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+
+    xdata_binding_t binding(table);
+    item.clear_xdata();
+  }
+
+  post_t::xdata_t& py_xdata(object self) {
+    post_t&         item = extract<post_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+
+    xdata_binding_t binding(table);
+    return item.xdata();
+  }
+
+  date_t py_date(object self) {
+    post_t&         item = extract<post_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+
+    xdata_binding_t binding(table);
+    return item.date();
   }
 
-  account_t * py_reported_account(post_t& post) {
-    return post.reported_account();
+  object py_reported_account(object self) {
+    post_t&         post = extract<post_t&>(self);
+    xdata_table_t * table = collection_xdata(self);
+    account_t *     account;
+    {
+      xdata_binding_t binding(table);
+      account = post.reported_account();
+    }
+
+    // The account is handed out by the same collection, if any; otherwise
+    // it is kept alive by the posting, as return_internal_reference would.
+    object result(ptr(account));
+    object collection(getattr(self, "_collection", object()));
+    if (collection.is_none())
+      objects::make_nurse_and_patient(result.ptr(), self.ptr());
+    return collected_item(collection, result);
   }
 
 } // unnamed namespace
@@ -159,7 +205,7 @@ void export_post()
     .def("get_tag", py_get_tag_1m)
     .def("get_tag", py_get_tag_2m)
 
-    .def("date", &post_t::date)
+    .def("date", py_date)
     .def("effective_date", &post_t::effective_date)
 
     .def("must_balance", &post_t::must_balance)
@@ -168,16 +214,15 @@ void export_post()
 
     .def("valid", &post_t::valid)
 
-    .def("has_xdata", &post_t::has_xdata)
-    .def("clear_xdata", &post_t::clear_xdata)
+    .def("has_xdata", py_has_xdata)
+    .def("clear_xdata", py_clear_xdata)
     .def("xdata", py_xdata,
          return_internal_reference<>())
 
     //.def("add_to_value", &post_t::add_to_value)
     .def("set_reported_account", &post_t::set_reported_account)
 
-    .def("reported_account", py_reported_account,
-         return_internal_reference<>())
+    .def("reported_account", py_reported_account)
     ;
 }
 
@@ -60,6 +60,10 @@ void export_xact();
 
 void initialize_for_python()
 {
+  // A Python script keeps its journals for as long as it runs
+  if (python_session.get())
+    python_session->resident = true;
+
   export_times();
   export_utils();
   export_commodity();
@@ -33,6 +33,7 @@
 #define _PYINTERP_H
 
 #include "session.h"
+#include "xdata.h"
 
 #if defined(HAVE_BOOST_PYTHON)
 
@@ -116,6 +117,21 @@ public:
 
 extern shared_ptr<python_interpreter_t> python_session;
 
+/**
+ * Hand a posting or account to Python on behalf of the collection it
+ * came from (see Journal.collect and Journal.query).  The item keeps the
+ * collection alive, and its accessors read the extended data that the
+ * collection's report left for it, rather than the item's own.
+ */
+python::object collected_item(const python::object& collection,
+                              const python::object& item);
+
+/**
+ * The xdata table of the collection an item was handed out by, to be
+ * bound while its extended data is read; or NULL if it has none.
+ */
+xdata_table_t * collection_xdata(const python::object& item);
+
 } // namespace ledger
 
 #endif // HAVE_BOOST_PYTHON
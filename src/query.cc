@@ -415,26 +415,110 @@ query_t::parser_t::parse_and_expr(lexer_t::token_t::kind_t tok_context)
   return expr_t::ptr_op_t();
 }
 
+namespace {
+  // The expression lexer reads at most this much of a mask, and the
+  // limiting predicate is printed and parsed again before it is used.
+  const std::size_t max_merged_pattern = 255;
+
+  // If a term is a match of some identifier against a mask of plain
+  // words, return the identifier.  Only such masks are merged, so that
+  // the result can still be matched without the regular expression.
+  const string * mask_match_ident(expr_t::ptr_op_t node)
+  {
+    if (node->kind == expr_t::op_t::O_MATCH &&
+        node->left()->is_ident() && node->right()->is_value() &&
+        node->right()->as_value().is_mask() &&
+        node->right()->as_value().as_mask().kind != mask_t::MATCH_REGEX)
+      return &node->left()->as_ident();
+    return NULL;
+  }
+
+  expr_t::ptr_op_t merge_mask_matches(expr_t::ptr_op_t   first,
+                                      std::list<string>& patterns)
+  {
+    expr_t::ptr_op_t node(first);
+    if (patterns.size() > 1) {
+      mask_t mask;
+      mask.assign_any(patterns);
+      DEBUG("query.mask", "Merged " << patterns.size() << " masks into: "
+            << mask.str() << (mask.kind == mask_t::MATCH_ANY ?
+                              " (any literal)" : ""));
+      node = expr_t::op_t::new_node(expr_t::op_t::O_MATCH, first->left(),
+                                    expr_t::op_t::wrap_value(mask));
+    }
+    patterns.clear();
+    return node;
+  }
+
+  expr_t::ptr_op_t add_or(expr_t::ptr_op_t node, expr_t::ptr_op_t term)
+  {
+    if (! node)
+      return term;
+    return expr_t::op_t::new_node(expr_t::op_t::O_OR, node, term);
+  }
+
+  // A run of adjacent terms such as "account =~ /a/ | account =~ /b/"
+  // becomes a single match against one mask holding every pattern, so
+  // that the text need only be scanned once.
+  expr_t::ptr_op_t merge_or_terms(const std::list<expr_t::ptr_op_t>& terms)
+  {
+    expr_t::ptr_op_t  node;
+    expr_t::ptr_op_t  run;
+    std::list<string> patterns;
+    std::size_t       length = 0;
+
+    foreach (expr_t::ptr_op_t next, terms) {
+      const string * ident = mask_match_ident(next);
+      string         pat;
+      if (ident)
+        pat = next->right()->as_value().as_mask().str();
+
+      if (run && ident && *ident == *mask_match_ident(run) &&
+          length + 1 + pat.length() <= max_merged_pattern) {
+        patterns.push_back(pat);
+        length += 1 + pat.length();
+        continue;
+      }
+      if (run)
+        node = add_or(node, merge_mask_matches(run, patterns));
+
+      if (ident) {
+        run    = next;
+        length = pat.length();
+        patterns.push_back(pat);
+      } else {
+        run  = NULL;
+        node = add_or(node, next);
+      }
+    }
+    if (run)
+      node = add_or(node, merge_mask_matches(run, patterns));
+
+    return node;
+  }
+}
+
 expr_t::ptr_op_t
 query_t::parser_t::parse_or_expr(lexer_t::token_t::kind_t tok_context)
 {
-  if (expr_t::ptr_op_t node = parse_and_expr(tok_context)) {
+  if (expr_t::ptr_op_t term = parse_and_expr(tok_context)) {
+    std::list<expr_t::ptr_op_t> terms;
+    terms.push_back(term);
+
     while (true) {
       lexer_t::token_t tok = lexer.next_token(tok_context);
       if (tok.kind == lexer_t::token_t::TOK_OR) {
-        expr_t::ptr_op_t prev(node);
-        node = new expr_t::op_t(expr_t::op_t::O_OR);
-        node->set_left(prev);
-        node->set_right(parse_and_expr(tok_context));
-        if (! node->right())
+        term = parse_and_expr(tok_context);
+        if (! term)
           throw_(parse_error,
                  _("%1 operator not followed by argument") << tok.symbol());
+        terms.push_back(term);
       } else {
         lexer.push_token(tok);
         break;
       }
     }
-    return node;
+    return merge_or_terms(terms);
   }
   return expr_t::ptr_op_t();
 }
@@ -443,18 +527,13 @@ expr_t::ptr_op_t
 query_t::parser_t::parse_query_expr(lexer_t::token_t::kind_t tok_context,
                                     bool                     subexpression)
 {
-  expr_t::ptr_op_t limiter;
+  // Terms given one after another are or'd together, and merged just as
+  // if the operator had been written out.
+  std::list<expr_t::ptr_op_t> terms;
+  while (expr_t::ptr_op_t next = parse_or_expr(tok_context))
+    terms.push_back(next);
 
-  while (expr_t::ptr_op_t next = parse_or_expr(tok_context)) {
-    if (! limiter) {
-      limiter = next;
-    } else {
-      expr_t::ptr_op_t prev(limiter);
-      limiter = new expr_t::op_t(expr_t::op_t::O_OR);
-      limiter->set_left(prev);
-      limiter->set_right(next);
-    }
-  }
+  expr_t::ptr_op_t limiter(merge_or_terms(terms));
 
   if (! subexpression) {
     if (limiter)
@@ -46,6 +46,7 @@
 #include "draft.h"
 #include "convert.h"
 #include "xml.h"
+#include "json.h"
 #include "emacs.h"
 #include "org.h"
 
@@ -304,6 +305,262 @@ namespace {
       report.session.journal->clear_xdata();
     }
   };
+
+  // Works out which postings of the journal can possibly pass the limit
+  // predicate, from the terms of its top-level conjunction: comparisons
+  // of "date" against a date literal (what --begin, --end and --period
+  // add) bound a slice of the date index, while payee, code, commodity and
+  // tag terms each select the postings listed under the keys they match.
+  // Anything else is left for the predicate, which still filters every
+  // posting walked.
+  struct limit_plan_t
+  {
+    journal_t&                              journal;
+    optional<date_t>                        begin;
+    optional<date_t>                        end;
+    optional<journal_t::post_sequences_t>   candidates;
+    bool                                    dates_only;
+
+    limit_plan_t(journal_t& _journal)
+      : journal(_journal), dates_only(true) {}
+
+    bool restricted() const {
+      return begin || end || candidates;
+    }
+
+    void add_terms(const expr_t::ptr_op_t& op) {
+      if (! op)
+        return;
+
+      if (op->kind == expr_t::op_t::O_AND) {
+        add_terms(op->left());
+        add_terms(op->right());
+      }
+      else if (! add_date_term(op)) {
+        add_index_term(op);
+        dates_only = false;
+      }
+    }
+
+    bool add_date_term(const expr_t::ptr_op_t& op) {
+      if (op->kind != expr_t::op_t::O_EQ  &&
+          op->kind != expr_t::op_t::O_LT  &&
+          op->kind != expr_t::op_t::O_LTE &&
+          op->kind != expr_t::op_t::O_GT  &&
+          op->kind != expr_t::op_t::O_GTE)
+        return false;
+
+      if (! op->left() || ! op->left()->is_ident() ||
+          op->left()->as_ident() != "date" ||
+          ! op->right() || ! op->right()->is_value() ||
+          ! op->right()->as_value().is_date())
+        return false;
+
+      date_t date = op->right()->as_value().as_date();
+
+      optional<date_t> lower, upper;
+      switch (op->kind) {
+      case expr_t::op_t::O_EQ:
+        lower = date;
+        upper = date + gregorian::days(1);
+        break;
+      case expr_t::op_t::O_LT:
+        upper = date;
+        break;
+      case expr_t::op_t::O_LTE:
+        upper = date + gregorian::days(1);
+        break;
+      case expr_t::op_t::O_GT:
+        lower = date + gregorian::days(1);
+        break;
+      case expr_t::op_t::O_GTE:
+        lower = date;
+        break;
+      default:
+        break;
+      }
+
+      if (lower && (! begin || *lower > *begin))
+        begin = lower;
+      if (upper && (! end || *upper < *end))
+        end = upper;
+      return true;
+    }
+
+    bool add_index_term(const expr_t::ptr_op_t& op) {
+      if (op->kind != expr_t::op_t::O_MATCH &&
+          op->kind != expr_t::op_t::O_EQ &&
+          op->kind != expr_t::op_t::O_CALL)
+        return false;
+      if (! op->left() || ! op->left()->is_ident() || ! op->right())
+        return false;
+
+      const string& name(op->left()->as_ident());
+      expr_t::ptr_op_t arg(op->right());
+      journal_t::post_index_t index;
+
+      if (op->kind == expr_t::op_t::O_CALL) {
+        if (name != "has_tag" && name != "has_meta")
+          return false;
+        // has_tag(/key/, /value/) is a superset of has_tag(/key/).
+        if (arg->kind == expr_t::op_t::O_SEQ && arg->left() &&
+            arg->left()->kind == expr_t::op_t::O_CONS)
+          arg = arg->left()->left();
+        index = journal_t::TAG_INDEX;
+      }
+      else if (name == "payee") {
+        index = journal_t::PAYEE_INDEX;
+      }
+      else if (name == "code") {
+        index = journal_t::CODE_INDEX;
+      }
+      else if (name == "commodity") {
+        index = journal_t::COMMODITY_INDEX;
+      }
+      else {
+        return false;
+      }
+
+      if (! arg || ! arg->is_value())
+        return false;
+
+      journal_t::post_sequences_t sequences;
+      if (arg->as_value().is_mask() && op->kind != expr_t::op_t::O_EQ)
+        journal.posts_by_key(index, arg->as_value().as_mask(), sequences);
+      else if (arg->as_value().is_string() &&
+               op->kind != expr_t::op_t::O_MATCH)
+        journal.posts_by_key(index, arg->as_value().as_string(), sequences);
+      else
+        return false;
+
+      intersect(sequences);
+      return true;
+    }
+
+    void intersect(journal_t::post_sequences_t& sequences) {
+      if (! candidates) {
+        candidates = journal_t::post_sequences_t();
+        candidates->swap(sequences);
+      } else {
+        journal_t::post_sequences_t both;
+        std::set_intersection(candidates->begin(), candidates->end(),
+                              sequences.begin(), sequences.end(),
+                              std::back_inserter(both));
+        candidates->swap(both);
+      }
+    }
+
+    void posts(posts_list& result) {
+      if (begin || end) {
+        journal_t::post_sequences_t sequences;
+        journal.posts_by_date(begin, end, sequences);
+        intersect(sequences);
+      }
+      journal.posts_by_sequence(*candidates, result);
+    }
+  };
+
+  // Whether a report would total the same from fewer postings carrying
+  // the same net amounts: the amount must be the posting's own, postings
+  // may be limited by date alone, and nothing ahead of the totals may
+  // rewrite or group postings by any other detail.
+  bool report_sums_amounts(report_t& report, const limit_plan_t& plan)
+  {
+    return (report.HANDLER(amount_).str() == "amount" &&
+            plan.dates_only &&
+            ! report.HANDLED(anon) && ! report.HANDLED(group_by_) &&
+            ! report.HANDLED(date_) && ! report.HANDLED(account_) &&
+            ! report.HANDLED(pivot_) && ! report.HANDLED(payee_) &&
+            ! report.HANDLED(related) && ! report.HANDLED(inject_));
+  }
+
+  // A periodic report only needs each day's net amount per account and
+  // commodity, since interval_posts subtotals whatever it is given.
+  // Building the rollups costs more than one report saves, so they are
+  // only used by sessions that will run several.  The journal cache is
+  // written before any report runs, so they are never part of it.
+  bool report_uses_rollups(report_t& report, const limit_plan_t& plan)
+  {
+    return (report.session.resident &&
+            report.HANDLED(period_) && report_sums_amounts(report, plan));
+  }
+
+  // A balance as of some date only needs the balances at the start of its
+  // month, plus whatever was posted since, provided the accounts are shown
+  // by their plain totals.  A format of the user's own might read the
+  // postings' count, dates or payees instead, so only the default one is
+  // trusted.  Like the rollups they are built from, the checkpoints only
+  // pay for themselves in a resident session, and are not cached either.
+  bool report_uses_checkpoints(report_t& report, const limit_plan_t& plan)
+  {
+    return (report.session.resident && plan.end && ! plan.begin &&
+            ! report.HANDLED(period_) && report_sums_amounts(report, plan) &&
+            report.HANDLER(total_).str() == "total" &&
+            report.HANDLER(display_total_).str() == "total_expr" &&
+            ! report.HANDLED(format_) &&
+            ! report.HANDLER(balance_format_).whence() &&
+            ! report.HANDLED(prepend_format_) &&
+            ! report.HANDLED(only_) && ! report.HANDLED(revalued) &&
+            ! report.HANDLED(dow) && ! report.HANDLED(by_payee));
+  }
+
+  // Budgeting and forecasting look at postings outside the limit, so they
+  // always see the whole journal.
+  void walk_journal_posts(post_handler_ptr handler, report_t& report,
+                          bool for_accounts_report = false)
+  {
+    if (report.budget_flags != BUDGET_NO_BUDGET ||
+        report.HANDLED(forecast_while_)) {
+      journal_posts_iterator walker(*report.session.journal.get());
+      pass_down_posts<journal_posts_iterator>(handler, walker);
+      return;
+    }
+
+    // Indexing the journal costs more than one linear walk through it
+    // saves, so like the rollups and checkpoints, the limit is only
+    // planned against the indexes in a resident session.
+    limit_plan_t plan(*report.session.journal.get());
+    if (report.session.resident && report.HANDLED(limit_))
+      plan.add_terms(expr_t(report.HANDLER(limit_).str()).get_op());
+
+    if (for_accounts_report && report_uses_checkpoints(report, plan)) {
+      posts_list  posts;
+      std::size_t count =
+        report.session.journal->balance_posts(*plan.end, posts);
+      DEBUG("report.predicate", "Walking " << posts.size() << " posting(s), "
+            << count << " of them from a balance checkpoint");
+
+      // Account totals are gathered from each account's own postings, so
+      // the checkpoint's must be reported against their accounts.
+      posts_list::iterator i = posts.begin();
+      for (; count > 0; --count, ++i)
+        (*i)->set_reported_account((*i)->account);
+
+      posts_list_iterator walker(posts);
+      pass_down_posts<posts_list_iterator>(handler, walker);
+    }
+    else if (report_uses_rollups(report, plan)) {
+      posts_list posts;
+      report.session.journal->rollups_by_date(plan.begin, plan.end, posts);
+      DEBUG("report.predicate",
+            "Walking " << posts.size() << " daily rollup(s)");
+
+      posts_list_iterator walker(posts);
+      pass_down_posts<posts_list_iterator>(handler, walker);
+    }
+    else if (plan.restricted()) {
+      posts_list posts;
+      plan.posts(posts);
+      DEBUG("report.predicate",
+            "Walking " << posts.size() << " posting(s) allowed by the limit");
+
+      posts_list_iterator walker(posts);
+      pass_down_posts<posts_list_iterator>(handler, walker);
+    } else {
+      journal_posts_iterator walker(*report.session.journal.get());
+      pass_down_posts<journal_posts_iterator>(handler, walker);
+    }
+  }
 }
 
 void report_t::posts_report(post_handler_ptr handler)
@@ -317,8 +574,7 @@ void report_t::posts_report(post_handler_ptr handler)
   }
   handler = chain_pre_post_handlers(handler, *this);
 
-  journal_posts_iterator walker(*session.journal.get());
-  pass_down_posts<journal_posts_iterator>(handler, walker);
+  walk_journal_posts(handler, *this);
 
   if (! HANDLED(group_by_))
     posts_flusher(handler, *this)(value_t());
@@ -436,8 +692,7 @@ void report_t::accounts_report(acct_handler_ptr handler)
   // The lifetime of the chain object controls the lifetime of all temporary
   // objects created within it during the call to pass_down_posts, which will
   // be needed later by the pass_down_accounts.
-  journal_posts_iterator walker(*session.journal.get());
-  pass_down_posts<journal_posts_iterator>(chain, walker);
+  walk_journal_posts(chain, *this, /* for_accounts_report= */ true);
 
   if (! HANDLED(group_by_))
     accounts_flusher(handler, *this)(value_t());
@@ -1034,6 +1289,8 @@ option_t<report_t> * report_t::lookup_option(const char * p)
     break;
   case 'j':
     OPT_CH(amount_data);
+    else OPT(jobs_);
+    else OPT(json);
     break;
   case 'l':
     OPT_(limit_);
@@ -1096,6 +1353,7 @@ option_t<report_t> * report_t::lookup_option(const char * p)
   case 's':
     OPT(sort_);
     else OPT(sort_all_);
+    else OPT(sort_budget_);
     else OPT(sort_xacts_);
     else OPT_(subtotal);
     else OPT(start_of_week_);
@@ -1388,6 +1646,11 @@ expr_t::ptr_op_t report_t::lookup(const symbol_t::kind_t kind,
 
     case 'b':
       if (*(p + 1) == '\0' || is_eq(p, "bal") || is_eq(p, "balance")) {
+        if (HANDLED(json))
+          return expr_t::op_t::wrap_functor
+            (reporter<account_t, acct_handler_ptr, &report_t::accounts_report>
+             (new format_json_accounts(*this), *this, "#balance"));
+
         return expr_t::op_t::wrap_functor
           (reporter<account_t, acct_handler_ptr, &report_t::accounts_report>
            (new format_accounts(*this, report_format(HANDLER(balance_format_)),
@@ -1413,6 +1676,15 @@ expr_t::ptr_op_t report_t::lookup(const symbol_t::kind_t kind,
 
     case 'c':
       if (is_eq(p, "csv")) {
+        // Unless the user asked for a different layout, the default CSV
+        // columns are written directly rather than through --csv-format.
+        if (! HANDLED(format_) && ! HANDLER(csv_format_).whence())
+          return WRAP_FUNCTOR
+            (reporter<>
+             (new format_csv(*this, maybe_format(HANDLER(prepend_format_)),
+                             HANDLER(prepend_width_).value.to_long()),
+              *this, "#csv"));
+
         return WRAP_FUNCTOR
           (reporter<>
            (new format_posts(*this, report_format(HANDLER(csv_format_)),
@@ -1497,6 +1769,10 @@ expr_t::ptr_op_t report_t::lookup(const symbol_t::kind_t kind,
 
     case 'r':
       if (*(p + 1) == '\0' || is_eq(p, "reg") || is_eq(p, "register")) {
+        if (HANDLED(json))
+          return WRAP_FUNCTOR
+            (reporter<>(new format_json_posts(*this), *this, "#register"));
+
         return WRAP_FUNCTOR
           (reporter<>
            (new format_posts(*this, report_format(HANDLER(register_format_)),
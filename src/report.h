@@ -274,6 +274,8 @@ public:
     HANDLER(head_).report(out);
     HANDLER(inject_).report(out);
     HANDLER(invert).report(out);
+    HANDLER(jobs_).report(out);
+    HANDLER(json).report(out);
     HANDLER(limit_).report(out);
     HANDLER(lot_dates).report(out);
     HANDLER(lot_prices).report(out);
@@ -315,6 +317,7 @@ public:
     HANDLER(seed_).report(out);
     HANDLER(sort_).report(out);
     HANDLER(sort_all_).report(out);
+    HANDLER(sort_budget_).report(out);
     HANDLER(sort_xacts_).report(out);
     HANDLER(start_of_week_).report(out);
     HANDLER(subtotal).report(out);
@@ -666,6 +669,16 @@ public:
                                                 text.as_string() + ")"));
    });
 
+  OPTION_(report_t, jobs_, DO_(args) {
+      if (args.get<long>(1) < 1)
+        throw_(std::invalid_argument,
+               _("Jobs must be a positive number of processes: %1")
+               << args.get<string>(1));
+      value = args.get<long>(1);
+    });
+
+  OPTION(report_t, json);
+
   OPTION(report_t, lot_dates);
   OPTION(report_t, lot_prices);
   OPTION(report_t, lot_tags);
@@ -904,6 +917,14 @@ public:
       parent->HANDLER(sort_xacts_).off();
     });
 
+  OPTION_(report_t, sort_budget_, DO_(args) {
+      if (args.get<long>(1) < 1)
+        throw_(std::invalid_argument,
+               _("Sort budget must be a positive number of bytes: %1")
+               << args.get<string>(1));
+      value = args.get<long>(1);
+    });
+
   OPTION_(report_t, sort_xacts_, DO_(args) {
       parent->HANDLER(sort_).on_with(string("--sort-xacts"), args[1]);
       parent->HANDLER(sort_all_).off();
@@ -71,6 +71,42 @@ expr_t::ptr_op_t symbol_scope_t::lookup(const symbol_t::kind_t kind,
   return child_scope_t::lookup(kind, name);
 }
 
+namespace {
+  struct builtin_less_t
+  {
+    bool operator()(const builtin_t& entry, const char * name) const {
+      return std::strcmp(entry.name, name) < 0;
+    }
+  };
+}
+
+expr_t::ptr_op_t lookup_builtin(const builtin_t * table,
+                                const std::size_t count,
+                                const string&     name)
+{
+#if defined(DEBUG_ON)
+  // The binary search below silently misses names if a table has been
+  // edited out of order, so check each table the first time it is used
+  // whenever we are debugging.
+  static std::set<const builtin_t *> checked_tables;
+  if (checked_tables.insert(table).second) {
+    for (std::size_t i = 1; i < count; i++)
+      assert(std::strcmp(table[i - 1].name, table[i].name) < 0);
+  }
+#endif
+
+  const builtin_t * end   = table + count;
+  const builtin_t * entry = std::lower_bound(table, end, name.c_str(),
+                                             builtin_less_t());
+  if (entry == end || std::strcmp(entry->name, name.c_str()) != 0)
+    return NULL;
+
+  if (entry->accessor)
+    return expr_t::op_t::wrap_accessor(entry->accessor);
+  else
+    return expr_t::op_t::wrap_functor(entry->function);
+}
+
 value_t& call_scope_t::resolve(const std::size_t index,
                                value_t::type_t   context,
                                const bool        required)
@@ -251,6 +251,44 @@ inline T& find_scope(child_scope_t& scope, bool skip_this = true)
   return reinterpret_cast<T&>(scope); // never executed
 }
 
+template <typename T, value_t (*Func)(T&)>
+value_t scope_accessor(scope_t& scope)
+{
+  if (T * sought = search_scope<T>(&scope))
+    return (*Func)(*sought);
+
+  throw_(std::runtime_error, _("Could not find scope"));
+  return NULL_VALUE;            // never executed
+}
+
+/**
+ * An entry in the table of built-in functions which an object makes
+ * available to value expressions.  Each table is kept sorted by name, so
+ * that lookup() can resolve a name with a binary search.  Functions of no
+ * arguments are given as accessors, which are invoked without building a
+ * call_scope_t; the rest are ordinary functors.
+ */
+struct builtin_t
+{
+  const char *             name;
+  expr_t::op_t::accessor_t accessor;
+  value_t               (* function)(call_scope_t&);
+};
+
+#define BUILTIN_ACCESSOR(type, func) &scope_accessor<type, &func>, NULL
+#define BUILTIN_FUNCTOR(func)        NULL, &func
+
+expr_t::ptr_op_t lookup_builtin(const builtin_t * table,
+                                const std::size_t count,
+                                const string&     name);
+
+template <std::size_t N>
+inline expr_t::ptr_op_t lookup_builtin(const builtin_t (&table)[N],
+                                       const string& name)
+{
+  return lookup_builtin(table, N, name);
+}
+
 class symbol_scope_t : public child_scope_t
 {
   typedef std::map<symbol_t, expr_t::ptr_op_t> symbol_map;
@@ -60,7 +60,8 @@ void set_session_context(session_t * session)
 }
 
 session_t::session_t()
-  : flush_on_next_data_file(false), journal(new journal_t)
+  : flush_on_next_data_file(false), reload_pending(false), resident(false),
+    journal(new journal_t)
 {
   TRACE_CTOR(session_t, "");
 
@@ -181,6 +182,51 @@ void session_t::close_journal_files()
 
   journal.reset(new journal_t);
   amount_t::initialize();
+
+  amount_t::parse_conversion("1.0m", "60s");
+  amount_t::parse_conversion("1.00h", "60m");
+}
+
+void session_t::watch_journal_files()
+{
+  if (! watcher.get())
+    watcher.reset(new file_watcher_t);
+
+  foreach (const journal_t::source_extent_t& extent, journal->extents)
+    foreach (const journal_t::fileinfo_t& info, extent.files)
+      watcher->watch(*info.filename);
+}
+
+void session_t::refresh_journal_files()
+{
+  std::set<path> touched;
+  if (watcher.get())
+    touched = watcher->changed_files();
+
+  // If reading failed last time, the journal was left empty; keep trying
+  // until the files read cleanly again.
+  try {
+    if (reload_pending || ! journal->refresh(touched)) {
+      INFO("Reading all journal files again");
+      close_journal_files();
+      reload_pending = true;
+      read_journal_files();
+      reload_pending = false;
+    }
+  }
+  catch (int) {
+    close_journal_files();
+    reload_pending = true;
+    throw_(parse_error, _("Changed journal files could not be read"));
+  }
+  catch (...) {
+    close_journal_files();
+    reload_pending = true;
+    throw;
+  }
+
+  if (watcher.get())
+    watch_journal_files();
 }
 
 value_t session_t::fn_account(call_scope_t& args)
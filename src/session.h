@@ -46,6 +46,7 @@
 #include "journal.h"
 #include "option.h"
 #include "commodity.h"
+#include "watcher.h"
 
 namespace ledger {
 
@@ -57,7 +58,14 @@ class session_t : public symbol_scope_t
 
 public:
   bool flush_on_next_data_file;
+  bool reload_pending;
+
+  // Whether the journal stays in memory to serve many reports, as in the
+  // REPL, the daemon or Python.  Only then is it worth building summaries
+  // of the journal that outlast the report which asked for them.
+  bool resident;
   std::auto_ptr<journal_t> journal;
+  std::auto_ptr<file_watcher_t> watcher;
 
   explicit session_t();
   virtual ~session_t() {
@@ -77,6 +85,19 @@ public:
   void read_journal_files();
   void close_journal_files();
 
+  /**
+   * Keep watching the journal's files for changes, so that
+   * refresh_journal_files() learns of them as soon as they are saved.
+   */
+  void watch_journal_files();
+
+  /**
+   * Bring the journal up to date with any of its files that changed.
+   * Only the changed files are read again where journal_t::refresh()
+   * allows it; otherwise every file is.
+   */
+  void refresh_journal_files();
+
   value_t fn_account(call_scope_t& scope);
   value_t fn_min(call_scope_t& scope);
   value_t fn_max(call_scope_t& scope);
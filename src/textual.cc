@@ -320,6 +320,17 @@ void instance_t::read_next_directive()
   if (len == 0 || line == NULL)
     return;
 
+  // Only xacts, comments and includes leave the reading of other files
+  // unaffected, which journal_t::refresh() relies on.
+  if (journal_t::source_extent_t * extent = context.journal.reading_extent) {
+    const char * p = (line[0] == '!' || line[0] == '@') ? line + 1 : line;
+    if (! (std::isdigit(static_cast<unsigned char>(*p)) ||
+           std::strchr(" \t;#*|", *p) ||
+           (std::strncmp(p, "include", 7) == 0 &&
+            std::isspace(static_cast<unsigned char>(p[7])))))
+      extent->isolated = false;
+  }
+
   switch (line[0]) {
   case '\0':
     assert(false);              // shouldn't ever reach here
@@ -501,6 +512,8 @@ void instance_t::price_xact_directive(char * line)
     commodity_pool_t::current_pool->parse_price_directive(skip_ws(line + 1));
   if (! point)
     throw parse_error(_("Pricing entry failed to parse"));
+
+  context.journal.price_directives.push_back(*point);
 }
 
 void instance_t::nomarket_directive(char * line)
@@ -762,6 +775,9 @@ void instance_t::include_directive(char * line)
 #endif // BOOST_VERSION >= 103700
         if (glob.match(base)) {
           path inner_file(*iter);
+          if (context.journal.reading_extent)
+            context.journal.reading_extent->files.push_back
+              (journal_t::fileinfo_t(inner_file));
           ifstream stream(inner_file);
           instance_t instance(context, stream, &inner_file, this);
           instance.parse();
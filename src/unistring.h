@@ -118,6 +118,20 @@ public:
   }
 };
 
+/**
+ * Return the number of characters in a UTF-8 encoded string.  This is
+ * what unistring(str).length() would return, but the string is only
+ * scanned, not decoded.
+ */
+inline std::size_t unicode_length(const std::string& str)
+{
+  std::size_t len = 0;
+  for (const char * p = str.c_str(), * end = p + str.length(); p != end; p++)
+    if ((static_cast<unsigned char>(*p) & 0xC0) != 0x80)
+      len++;
+  return len;
+}
+
 inline void justify(std::ostream&      out,
                     const std::string& str,
                     int                width,
@@ -130,9 +144,7 @@ inline void justify(std::ostream&      out,
     if (redden) out << "\033[0m";
   }
 
-  unistring temp(str);
-
-  int spacing = width - int(temp.length());
+  int spacing = width - int(unicode_length(str));
   while (spacing-- > 0)
     out << ' ';
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2003-2010, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <system.hh>
+
+#include "watcher.h"
+
+#if defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#include <fcntl.h>
+#endif
+
+namespace ledger {
+
+file_watcher_t::file_watcher_t() : watch_fd(-1)
+{
+  TRACE_CTOR(file_watcher_t, "");
+
+#if defined(HAVE_SYS_INOTIFY_H)
+  watch_fd = inotify_init();
+  if (watch_fd != -1)
+    fcntl(watch_fd, F_SETFL, fcntl(watch_fd, F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+file_watcher_t::~file_watcher_t()
+{
+  TRACE_DTOR(file_watcher_t);
+
+  if (watch_fd != -1)
+    ::close(watch_fd);
+}
+
+void file_watcher_t::watch(const path& file)
+{
+  if (! files.insert(file).second)
+    return;
+
+#if defined(HAVE_SYS_INOTIFY_H)
+  if (watch_fd == -1)
+    return;
+
+  path directory(file.parent_path());
+  if (directory.empty())
+    directory = ".";
+
+  int wd = inotify_add_watch(watch_fd, directory.string().c_str(),
+                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+                             IN_DELETE | IN_MODIFY);
+  if (wd != -1)
+    directories[wd] = file.parent_path();
+
+  DEBUG("watcher", "watching " << file << " through " << directory);
+#endif
+}
+
+std::set<path> file_watcher_t::changed_files()
+{
+  std::set<path> touched;
+
+#if defined(HAVE_SYS_INOTIFY_H)
+  if (watch_fd != -1) {
+    char    buf[4096]
+      __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    while ((len = ::read(watch_fd, buf, sizeof(buf))) > 0) {
+      for (char * p = buf; p < buf + len; ) {
+        const inotify_event * event = reinterpret_cast<inotify_event *>(p);
+        p += sizeof(inotify_event) + event->len;
+
+        std::map<int, path>::iterator dir = directories.find(event->wd);
+        if (dir == directories.end() || event->len == 0)
+          continue;
+
+        path file((*dir).second / event->name);
+        if (files.find(file) != files.end()) {
+          DEBUG("watcher", "changed: " << file);
+          touched.insert(file);
+        }
+      }
+    }
+  }
+#endif
+
+  return touched;
+}
+
+} // namespace ledger
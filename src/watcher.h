@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2003-2010, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup util
+ */
+
+/**
+ * @file   watcher.h
+ * @author John Wiegley
+ *
+ * @ingroup util
+ *
+ * @brief Notice when the files a session has read are written to.
+ *
+ * Where inotify is available, the directories holding the watched files
+ * are monitored, so that files replaced by an editor renaming a new
+ * copy over them are noticed as well as files written in place.
+ */
+#ifndef _WATCHER_H
+#define _WATCHER_H
+
+#include "utils.h"
+
+namespace ledger {
+
+class file_watcher_t : public noncopyable
+{
+  int                 watch_fd;
+  std::map<int, path> directories;
+  std::set<path>      files;
+
+public:
+  file_watcher_t();
+  ~file_watcher_t();
+
+  /**
+   * Start watching a file, if it is not watched already.
+   */
+  void watch(const path& file);
+
+  /**
+   * @return A descriptor which becomes readable when a watched file may
+   * have changed, for use with poll(); or -1 if change notification is
+   * not available on this platform.
+   */
+  int descriptor() const {
+    return watch_fd;
+  }
+
+  /**
+   * Collect any pending notifications, without blocking.
+   *
+   * @return The watched files written to since the last call.
+   */
+  std::set<path> changed_files();
+};
+
+} // namespace ledger
+
+#endif // _WATCHER_H
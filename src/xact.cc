@@ -503,11 +503,6 @@ namespace {
     return string_value(xact.payee);
   }
 
-  template <value_t (*Func)(xact_t&)>
-  value_t get_wrapper(call_scope_t& scope) {
-    return (*Func)(find_scope<xact_t>(scope));
-  }
-
   value_t fn_any(call_scope_t& args)
   {
     post_t& post(args.context<post_t>());
@@ -533,6 +528,18 @@ namespace {
     }
     return true;
   }
+
+  // This table must be kept in sorted order.
+  const builtin_t xact_builtins[] = {
+    { "all",        BUILTIN_FUNCTOR(fn_all) },
+    { "any",        BUILTIN_FUNCTOR(fn_any) },
+    { "code",       BUILTIN_ACCESSOR(xact_t, get_code) },
+    { "id",         BUILTIN_ACCESSOR(xact_t, get_id) },
+    { "idstring",   BUILTIN_ACCESSOR(xact_t, get_idstring) },
+    { "magnitude",  BUILTIN_ACCESSOR(xact_t, get_magnitude) },
+    { "p",          BUILTIN_ACCESSOR(xact_t, get_payee) },
+    { "payee",      BUILTIN_ACCESSOR(xact_t, get_payee) },
+  };
 }
 
 expr_t::ptr_op_t xact_t::lookup(const symbol_t::kind_t kind,
@@ -541,36 +548,8 @@ expr_t::ptr_op_t xact_t::lookup(const symbol_t::kind_t kind,
   if (kind != symbol_t::FUNCTION)
     return item_t::lookup(kind, name);
 
-  switch (name[0]) {
-  case 'a':
-    if (name == "any")
-      return WRAP_FUNCTOR(&fn_any);
-    else if (name == "all")
-      return WRAP_FUNCTOR(&fn_all);
-    break;
-
-  case 'c':
-    if (name == "code")
-      return WRAP_FUNCTOR(get_wrapper<&get_code>);
-    break;
-
-  case 'i':
-    if (name == "id")
-      return WRAP_FUNCTOR(get_wrapper<&get_id>);
-    else if (name == "idstring")
-      return WRAP_FUNCTOR(get_wrapper<&get_idstring>);
-    break;
-
-  case 'm':
-    if (name == "magnitude")
-      return WRAP_FUNCTOR(get_wrapper<&get_magnitude>);
-    break;
-
-  case 'p':
-    if (name[1] == '\0' || name == "payee")
-      return WRAP_FUNCTOR(get_wrapper<&get_payee>);
-    break;
-  }
+  if (expr_t::ptr_op_t def = lookup_builtin(xact_builtins, name))
+    return def;
 
   return item_t::lookup(kind, name);
 }
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2003-2010, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup data
+ */
+
+/**
+ * @file   xdata.h
+ * @author John Wiegley
+ *
+ * @ingroup data
+ *
+ * @brief Per-report storage for posting and account extended data.
+ *
+ * Normally the transient data a report attaches to postings and
+ * accounts lives inside those objects, which means only one report can
+ * be walking a journal at a time.  Binding an xdata_table_t redirects
+ * that data into the table instead, so several reports (such as open
+ * Python collections) can each keep their own results for the same
+ * journal.
+ *
+ * This lets reports interleave, not run in parallel.  The binding is
+ * process-wide, as are the session's journal, the commodity pool's
+ * price caches and the scratch values used by amount arithmetic, so
+ * reports started from Python threads still take turns under the GIL.
+ */
+#ifndef _XDATA_H
+#define _XDATA_H
+
+#include "post.h"
+#include "account.h"
+
+namespace ledger {
+
+class xdata_table_t : public noncopyable
+{
+public:
+  // Every xdata() call looks its object up here, so the tables are
+  // hashed.  Their elements stay put as others are added, so references
+  // handed out remain valid.
+  typedef boost::unordered_map<const post_t *, post_t::xdata_t>
+    post_map;
+  typedef boost::unordered_map<const account_t *, account_t::xdata_t>
+    account_map;
+
+  post_map    posts;
+  account_map accounts;
+
+  xdata_table_t() {
+    TRACE_CTOR(xdata_table_t, "");
+  }
+  ~xdata_table_t() {
+    TRACE_DTOR(xdata_table_t);
+  }
+
+  bool empty() const {
+    return posts.empty() && accounts.empty();
+  }
+  void clear() {
+    posts.clear();
+    accounts.clear();
+  }
+};
+
+/**
+ * @brief Make a table the home of extended data for a scope
+ *
+ * While an xdata_binding_t is alive, every xdata() lookup on a posting
+ * or account goes to its table; the previous binding is restored when
+ * it is destroyed.  The binding is process-wide, so from Python it must
+ * only be made while holding the GIL.
+ */
+class xdata_binding_t : public noncopyable
+{
+  xdata_table_t * previous;
+
+public:
+  explicit xdata_binding_t(xdata_table_t& table)
+    : previous(current_xdata_table) {
+    TRACE_CTOR(xdata_binding_t, "xdata_table_t&");
+    current_xdata_table = &table;
+  }
+  // Bind a table if there is one, or leave the current binding.
+  explicit xdata_binding_t(xdata_table_t * table)
+    : previous(current_xdata_table) {
+    TRACE_CTOR(xdata_binding_t, "xdata_table_t *");
+    if (table)
+      current_xdata_table = table;
+  }
+  ~xdata_binding_t() {
+    TRACE_DTOR(xdata_binding_t);
+    current_xdata_table = previous;
+  }
+};
+
+} // namespace ledger
+
+#endif // _XDATA_H
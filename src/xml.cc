@@ -70,26 +70,34 @@ namespace {
     foreach (const accounts_map::value_type& pair, acct->accounts)
       xml_account(out, pair.second);
   }
+}
 
-  void xml_transaction(std::ostream& out, const xact_t * xact) {
-    to_xml(out, *xact);
+void format_xml::start_document()
+{
+  std::ostream& out(report.output_stream);
 
-    foreach (const post_t * post, xact->posts)
-      if (post->has_xdata() &&
-          post->xdata().has_flags(POST_EXT_VISITED))
-        to_xml(out, *post);
+  out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+  out << "<ledger version=\"" << VERSION << "\">\n";
 
-    out << "</transaction>\n";
-  }
+  out << "<transactions>\n";
+  started = true;
 }
 
 void format_xml::flush()
 {
   std::ostream& out(report.output_stream);
 
-  out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
-  out << "<ledger version=\"" << VERSION << "\">\n";
+  if (! started)
+    start_document();
 
+  if (last_xact) {
+    out << "</transaction>\n";
+    last_xact = NULL;
+  }
+  out << "</transactions>\n";
+
+  // Commodities and account totals are only complete once every posting
+  // has been seen, so they follow the transactions.
   out << "<commodities>\n";
   foreach (const commodities_pair& pair, commodities) {
     to_xml(out, *pair.second, true);
@@ -101,11 +109,6 @@ void format_xml::flush()
   xml_account(out, report.session.journal->master);
   out << "</accounts>\n";
 
-  out << "<transactions>\n";
-  foreach (const xact_t * xact, transactions)
-    xml_transaction(out, xact);
-  out << "</transactions>\n";
-
   out << "</ledger>\n";
   out.flush();
 }
@@ -114,11 +117,23 @@ void format_xml::operator()(post_t& post)
 {
   assert(post.xdata().has_flags(POST_EXT_VISITED));
 
+  std::ostream& out(report.output_stream);
+
+  if (! started)
+    start_document();
+
   commodities.insert(commodities_pair(post.amount.commodity().symbol(),
                                       &post.amount.commodity()));
 
-  if (transactions_set.find(post.xact) == transactions_set.end())
-    transactions.push_back(post.xact);
+  // Postings are written as they arrive, grouped under their transaction
+  // for as long as they arrive together.
+  if (post.xact != last_xact) {
+    if (last_xact)
+      out << "</transaction>\n";
+    to_xml(out, *post.xact);
+    last_xact = post.xact;
+  }
+  to_xml(out, post);
 }
 
 } // namespace ledger
@@ -57,9 +57,10 @@ class post_t;
 class report_t;
 
 /**
- * @brief Brief
+ * @brief Write postings as an XML document
  *
- * Long.
+ * Transactions are written as their postings arrive; the commodities and
+ * account totals, which are only known at the end, follow them.
  */
 class format_xml : public item_handler<post_t>
 {
@@ -69,12 +70,15 @@ protected:
   typedef std::map<string, commodity_t *>  commodities_map;
   typedef std::pair<string, commodity_t *> commodities_pair;
 
-  commodities_map      commodities;
-  std::set<xact_t *>   transactions_set;
-  std::deque<xact_t *> transactions;
+  commodities_map commodities;
+  xact_t *        last_xact;
+  bool            started;
+
+  void start_document();
 
 public:
-  format_xml(report_t& _report) : report(_report) {
+  format_xml(report_t& _report)
+    : report(_report), last_xact(NULL), started(false) {
     TRACE_CTOR(format_xml, "report&");
   }
   virtual ~format_xml() {
@@ -86,8 +90,8 @@ public:
 
   virtual void clear() {
     commodities.clear();
-    transactions_set.clear();
-    transactions.clear();
+    last_xact = NULL;
+    started   = false;
 
     item_handler<post_t>::clear();
   }
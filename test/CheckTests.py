@@ -26,6 +26,8 @@ untested_options = [
     'anon',
     'args-only',
     'cache',
+    'client',
+    'daemon',
     'debug',
     'download',
     'file',
@@ -0,0 +1,99 @@
+# -*- coding: utf-8 -*-
+
+import os
+import tempfile
+import unittest
+
+from ledger import *
+
+journal_text = """
+~ Monthly
+    Expenses:Food                $50
+    Assets:Cash
+
+2010/01/05 Grocer
+    Expenses:Food:Fruit          $10
+    Assets:Cash
+
+2010/01/20 Grocer
+    Expenses:Food:Dairy          $20
+    Assets:Cash
+"""
+
+class CollectionTestCase(unittest.TestCase):
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp(suffix='.dat')
+        os.write(fd, journal_text.encode('utf-8'))
+        os.close(fd)
+        self.journal = Journal()
+        self.journal.read(self.path)
+
+    def tearDown(self):
+        self.journal = None
+        os.remove(self.path)
+
+    def journalPosts(self, coll):
+        return [post for post in coll
+                if post.account.fullname().startswith('Expenses:Food:')]
+
+    def testTwoCollectionsAtOnce(self):
+        # The same journal postings are reported by both collections, but
+        # only the budget report moves them to the budgeted account.
+        plain  = self.journal.collect('^expenses')
+        budget = self.journal.collect('--budget ^expenses')
+
+        plain_posts  = self.journalPosts(plain)
+        budget_posts = self.journalPosts(budget)
+        self.assertEqual(2, len(plain_posts))
+        self.assertEqual(2, len(budget_posts))
+
+        # Read back and forth, so that each lookup must use the data of
+        # the collection the posting came from.
+        for i in range(2):
+            plain_post  = plain_posts[i]
+            budget_post = budget_posts[i]
+            self.assertTrue(plain_post.has_xdata())
+            self.assertTrue(budget_post.has_xdata())
+            self.assertEqual(plain_post.account.fullname(),
+                             plain_post.reported_account().fullname())
+            self.assertEqual('Expenses:Food',
+                             budget_post.reported_account().fullname())
+
+        self.assertEqual(Amount('$10'), plain_posts[0].xdata().total)
+        self.assertEqual(Amount('$30'), plain_posts[1].xdata().total)
+
+        # Each collection's running total is its own postings' sum.
+        running = None
+        for post in budget:
+            if running is None:
+                running = post.amount
+            else:
+                running = running + post.amount
+            self.assertEqual(running, post.xdata().total)
+
+        self.assertEqual(Amount('$10'), plain_posts[0].xdata().total)
+        self.assertEqual(Amount('$10'), plain.xdata(plain_posts[0]).total)
+
+    def testAccountXData(self):
+        plain = self.journal.collect('^expenses')
+        post  = plain[0]
+
+        # The account the collection reported to carries its data along,
+        # which the journal's own account object does not.
+        account = post.reported_account()
+        self.assertTrue(account.has_xdata())
+        self.assertTrue(account.xdata().has_flags(ACCOUNT_EXT_VISITED))
+        self.assertTrue(plain.xdata(post.account).has_flags(ACCOUNT_EXT_VISITED))
+
+        fruit = self.journal.find_account('Expenses:Food:Fruit')
+        self.assertFalse(fruit.has_xdata())
+
+        other = self.journal.collect('^assets')
+        self.assertFalse(other.xdata(fruit).has_flags(ACCOUNT_EXT_VISITED))
+        self.assertTrue(account.xdata().has_flags(ACCOUNT_EXT_VISITED))
+
+def suite():
+    return unittest.TestLoader().loadTestsFromTestCase(CollectionTestCase)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,126 @@
+# -*- coding: utf-8 -*-
+
+import ctypes
+import datetime
+import decimal
+import os
+import struct
+import tempfile
+import unittest
+
+from ledger import *
+
+journal_text = """
+2010/01/05 Grocer
+    Expenses:Food                $10.50
+    Assets:Cash
+
+2010/01/20 Miner
+    Assets:Dust                  0.0000000000000000001 DUST
+    Equity:Opening
+
+2010/02/03 Cinema
+    Expenses:Movies              12 EUR
+    Assets:Cash
+
+2010/02/14 Grocer
+    Expenses:Food                 $5
+    Assets:Cash
+"""
+
+query = 'expenses or assets or equity'
+
+class ColumnsTestCase(unittest.TestCase):
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp(suffix='.dat')
+        os.write(fd, journal_text.encode('utf-8'))
+        os.close(fd)
+        self.journal = Journal()
+        self.journal.read(self.path)
+
+    def tearDown(self):
+        self.journal = None
+        os.remove(self.path)
+
+    def checkView(self, column, format, itemsize, length):
+        view = memoryview(column)
+        self.assertEqual(format, view.format)
+        self.assertEqual(itemsize, view.itemsize)
+        self.assertEqual(1, view.ndim)
+        self.assertEqual((length,), view.shape)
+        self.assertEqual((itemsize,), view.strides)
+        self.assertTrue(view.readonly)
+        self.assertEqual(length, len(column))
+        # memoryview.tolist() only handles bytes in older Pythons.
+        return list(struct.unpack('=%d%s' % (length, format),
+                                  view.tobytes()))
+
+    def testColumnsMatchCollect(self):
+        columns = self.journal.columns(query)
+        posts   = list(self.journal.collect(query))
+        length  = len(posts)
+        self.assertEqual(8, length)
+        self.assertEqual(length, len(columns))
+
+        dates      = self.checkView(columns.date, 'i', 4, length)
+        accounts   = self.checkView(columns.account, 'i', 4, length)
+        payees     = self.checkView(columns.payee, 'i', 4, length)
+        comms      = self.checkView(columns.commodity, 'i', 4, length)
+        quantities = self.checkView(columns.quantity, 'q', 8, length)
+        floats     = self.checkView(columns.quantity_float, 'd', 8, length)
+
+        epoch = datetime.date(1970, 1, 1)
+        for i in range(length):
+            post = posts[i]
+            self.assertEqual((post.date() - epoch).days, dates[i])
+            self.assertEqual(post.reported_account().fullname(),
+                             columns.accounts[accounts[i]])
+            self.assertEqual(post.xact.payee, columns.payees[payees[i]])
+
+            commodity = post.amount.commodity
+            self.assertEqual(commodity.symbol, columns.commodities[comms[i]])
+            self.assertEqual(commodity.precision, columns.scales[comms[i]])
+
+            number = post.amount.number()
+            self.assertEqual(number.to_double(), floats[i])
+
+            # Quantities are only exact while 10^scale fits in an integer.
+            scale = columns.scales[comms[i]]
+            if commodity.symbol == 'DUST':
+                self.assertEqual(PostColumns.INEXACT, quantities[i])
+            else:
+                scaled = decimal.Decimal(str(number)).scaleb(scale)
+                self.assertEqual(int(scaled), quantities[i])
+
+        # Each string table holds every distinct value once.
+        self.assertEqual(sorted(set(columns.accounts)),
+                         sorted(columns.accounts))
+        self.assertEqual(['Grocer', 'Miner', 'Cinema'], columns.payees)
+        self.assertEqual(['$', 'DUST', 'EUR'], columns.commodities)
+        self.assertEqual([2, 19, 0], columns.scales)
+        self.assertEqual([1050, -1050], quantities[0:2])
+        self.assertEqual([500, -500], quantities[6:8])
+
+    def testEmptyColumns(self):
+        columns = self.journal.columns('income')
+        self.assertEqual(0, len(columns))
+        self.assertEqual([], self.checkView(columns.date, 'i', 4, 0))
+        self.assertEqual([], self.checkView(columns.quantity, 'q', 8, 0))
+
+    def testColumnsAreReadOnly(self):
+        columns = self.journal.columns(query)
+        view    = memoryview(columns.quantity)
+        def write():
+            view[0] = 0
+        self.assertRaises(TypeError, write)
+
+        # Asking for a writable buffer outright is refused as well.
+        buffer_type = ctypes.c_int64 * len(columns)
+        self.assertRaises((BufferError, TypeError),
+                          buffer_type.from_buffer, columns.quantity)
+
+def suite():
+    return unittest.TestLoader().loadTestsFromTestCase(ColumnsTestCase)
+
+if __name__ == '__main__':
+    unittest.main()
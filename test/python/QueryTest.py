@@ -0,0 +1,95 @@
+# -*- coding: utf-8 -*-
+
+import gc
+import os
+import tempfile
+import unittest
+
+from ledger import *
+
+journal_text = """
+2010/01/05 Grocer
+    Expenses:Food                $10
+    Assets:Cash
+
+2010/01/20 Grocer
+    Expenses:Food                $20
+    Assets:Cash
+
+2010/02/03 Cinema
+    Expenses:Movies              $12
+    Assets:Cash
+
+2010/02/14 Grocer
+    Expenses:Food                 $5
+    Assets:Cash
+
+2010/03/01 Bookshop
+    Expenses:Books               $30
+    Assets:Cash
+"""
+
+class QueryTestCase(unittest.TestCase):
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp(suffix='.dat')
+        os.write(fd, journal_text.encode('utf-8'))
+        os.close(fd)
+        self.journal = Journal()
+        self.journal.read(self.path)
+
+    def tearDown(self):
+        self.journal = None
+        os.remove(self.path)
+
+    def amounts(self, posts):
+        return [str(post.amount) for post in posts]
+
+    def testQueryMatchesCollect(self):
+        collected = self.amounts(self.journal.collect('^expenses'))
+        queried   = self.amounts(self.journal.query('^expenses'))
+        self.assertEqual(['$10', '$20', '$12', '$5', '$30'], collected)
+        self.assertEqual(collected, queried)
+
+    def testNextAfterEnd(self):
+        stream = self.journal.query('books')
+        self.assertEqual('$30', str(stream.next().amount))
+        self.assertRaises(StopIteration, stream.next)
+        self.assertRaises(StopIteration, stream.next)
+
+    def testBatch(self):
+        stream = self.journal.query('^expenses')
+        self.assertEqual([], stream.batch(0))
+        self.assertEqual(['$10', '$20'], self.amounts(stream.batch(2)))
+        self.assertEqual(['$12', '$5'], self.amounts(stream.batch(2)))
+        self.assertEqual(['$30'], self.amounts(stream.batch(2)))
+        self.assertEqual([], stream.batch(2))
+
+    def testBatchAfterNext(self):
+        stream = self.journal.query('^expenses')
+        self.assertEqual('$10', str(stream.next().amount))
+        self.assertEqual(['$20', '$12', '$5', '$30'],
+                         self.amounts(stream.batch(10)))
+
+    def testNegativeBatch(self):
+        stream = self.journal.query('^expenses')
+        self.assertRaises(ValueError, stream.batch, -1)
+        # The stream is left as it was.
+        self.assertEqual(['$10'], self.amounts(stream.batch(1)))
+
+    def testBatchKeepsStream(self):
+        # Nothing but the postings refers to the stream once the batch is
+        # taken, yet they must still read its data.
+        posts = self.journal.query('food').batch(3)
+        gc.collect()
+        self.assertEqual(['$10', '$20', '$5'], self.amounts(posts))
+        self.assertEqual(Amount('$10'), posts[0].xdata().total)
+        self.assertEqual(Amount('$30'), posts[1].xdata().total)
+        self.assertEqual(Amount('$35'), posts[2].xdata().total)
+        self.assertEqual('Expenses:Food',
+                         posts[2].reported_account().fullname())
+
+def suite():
+    return unittest.TestLoader().loadTestsFromTestCase(QueryTestCase)
+
+if __name__ == '__main__':
+    unittest.main()
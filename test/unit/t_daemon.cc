@@ -0,0 +1,115 @@
+#define BOOST_TEST_DYN_LINK
+//#define BOOST_TEST_MODULE daemon
+#include <boost/test/unit_test.hpp>
+
+#include <system.hh>
+
+#include "utils.h"
+#include "daemon.h"
+
+#ifndef WIN32
+#include <sys/wait.h>
+#endif
+
+using namespace ledger;
+
+struct daemon_fixture {
+#ifndef NOT_FOR_PYTHON
+#ifndef WIN32
+  path socket_path;
+#endif // WIN32
+#endif // NOT_FOR_PYTHON
+
+  daemon_fixture() {
+#ifndef NOT_FOR_PYTHON
+#ifndef WIN32
+    std::ostringstream name;
+    name << "/tmp/ledger-t_daemon-" << ::getpid() << ".sock";
+    socket_path = path(name.str());
+#endif // WIN32
+#endif // NOT_FOR_PYTHON
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(daemon_socket, daemon_fixture)
+
+BOOST_AUTO_TEST_CASE(testRoundTrip)
+{
+#ifndef NOT_FOR_PYTHON
+#ifndef WIN32
+  daemon_socket_t listener(socket_path);
+
+  struct stat info;
+  BOOST_CHECK_EQUAL(0, ::stat(socket_path.string().c_str(), &info));
+  BOOST_CHECK_EQUAL(static_cast<mode_t>(S_IRUSR | S_IWUSR),
+                    info.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO));
+
+  std::cout.flush();
+  std::cerr.flush();
+
+  pid_t child = ::fork();
+  BOOST_REQUIRE(child != -1);
+
+  if (child == 0) {
+    // Serve a single request, echoing its arguments to each channel.
+    int status = 1;
+    try {
+      strings_list args;
+      int fd = listener.accept_request(args);
+      if (fd >= 0) {
+        daemon_response_t response(fd);
+        foreach (const string& arg, args)
+          std::cout << '[' << arg << ']';
+        std::cout << std::endl;
+        std::cerr << args.size() << std::endl;
+        response.finish(3);
+        status = 0;
+      }
+    }
+    catch (...) {}
+    ::_exit(status);
+  }
+
+  strings_list args;
+  args.push_back("reg");
+  args.push_back("");
+  args.push_back("two words");
+
+  std::ostringstream out;
+  std::ostringstream err;
+  std::streambuf * cout_buf = std::cout.rdbuf(out.rdbuf());
+  std::streambuf * cerr_buf = std::cerr.rdbuf(err.rdbuf());
+
+  int status = -1;
+  try {
+    status = forward_to_daemon(socket_path, args);
+  }
+  catch (...) {}
+
+  std::cout.rdbuf(cout_buf);
+  std::cerr.rdbuf(cerr_buf);
+
+  int child_status = -1;
+  ::waitpid(child, &child_status, 0);
+
+  BOOST_CHECK_EQUAL(3, status);
+  BOOST_CHECK_EQUAL(string("[reg][][two words]\n"), out.str());
+  BOOST_CHECK_EQUAL(string("3\n"), err.str());
+  BOOST_CHECK(WIFEXITED(child_status));
+  BOOST_CHECK_EQUAL(0, WEXITSTATUS(child_status));
+#endif // WIN32
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testNoDaemon)
+{
+#ifndef NOT_FOR_PYTHON
+#ifndef WIN32
+  strings_list args;
+  args.push_back("reg");
+  BOOST_CHECK_THROW(forward_to_daemon(socket_path, args), daemon_error);
+#endif // WIN32
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include "predicate.h"
 #include "query.h"
 #include "op.h"
+#include "scope.h"
 
 using namespace ledger;
 
@@ -331,4 +332,128 @@ BOOST_AUTO_TEST_CASE(testPredicateTokenizer16)
 #endif
 }
 
+BOOST_AUTO_TEST_CASE(testMergedMasksSurviveLimit)
+{
+  value_t args;
+  args.push_back(string_value("^Expenses:Travel"));
+  args.push_back(string_value("^Expenses:Meals"));
+
+#ifndef NOT_FOR_PYTHON
+  // A report keeps the limit as text in --limit, and parses it again.
+  query_t query(args, keep_details_t());
+  BOOST_REQUIRE(query.has_query(query_t::QUERY_LIMIT));
+  predicate_t limit(query.get_query(query_t::QUERY_LIMIT), keep_details_t());
+
+  expr_t::ptr_op_t op(limit.get_op());
+  BOOST_REQUIRE(op && op->kind == expr_t::op_t::O_MATCH);
+
+  const mask_t& mask(op->right()->as_value().as_mask());
+  BOOST_CHECK_EQUAL(mask_t::MATCH_ANY, mask.kind);
+  BOOST_CHECK(mask.match("Expenses:Meals:Lunch"));
+  BOOST_CHECK(mask.match("expenses:travel"));
+  BOOST_CHECK(! mask.match("Assets:Expenses:Meals"));
+#endif
+}
+
+namespace {
+  struct counting_amount_t
+  {
+    int * calls;
+
+    counting_amount_t(int * _calls) : calls(_calls) {}
+
+    value_t operator()(call_scope_t&) {
+      ++*calls;
+      return 4L;
+    }
+  };
+}
+
+namespace {
+  value_t count_args(call_scope_t& args)
+  {
+    return static_cast<long>(args.size());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testConstantArguments)
+{
+  int            calls = 0;
+  symbol_scope_t scope;
+  scope.define(symbol_t::FUNCTION, "amount",
+               WRAP_FUNCTOR(counting_amount_t(&calls)));
+  scope.define(symbol_t::FUNCTION, "count",
+               WRAP_FUNCTOR(&count_args));
+
+  // The constant arguments of a call stay separate arguments.
+  expr_t call("count(amount, 20, -1, true)");
+  call.compile(scope);
+  BOOST_CHECK_EQUAL(value_t(4L), call.calc(scope));
+
+  expr_t constants("count(80, 80, true)");
+  constants.compile(scope);
+  BOOST_CHECK_EQUAL(value_t(3L), constants.calc(scope));
+}
+
+BOOST_AUTO_TEST_CASE(testConstantBranches)
+{
+  int            calls = 0;
+  symbol_scope_t scope;
+  scope.define(symbol_t::FUNCTION, "amount",
+               WRAP_FUNCTOR(counting_amount_t(&calls)));
+
+  expr_t query("amount > 3 ? \"big\" : \"small\"");
+  query.compile(scope);
+  BOOST_REQUIRE(query.get_op()->kind == expr_t::op_t::O_QUERY);
+  BOOST_CHECK(query.get_op()->right()->kind == expr_t::op_t::O_COLON);
+  BOOST_CHECK_EQUAL(string_value("big"), query.calc(scope));
+
+  expr_t settled("1 > 3 ? \"big\" : \"small\"");
+  settled.compile(scope);
+  BOOST_REQUIRE(settled.get_op()->is_value());
+  BOOST_CHECK_EQUAL(string_value("small"), settled.get_op()->as_value());
+}
+
+BOOST_AUTO_TEST_CASE(testConstantFolding)
+{
+  int            calls = 0;
+  symbol_scope_t scope;
+  scope.define(symbol_t::FUNCTION, "amount",
+               WRAP_FUNCTOR(counting_amount_t(&calls)));
+
+  expr_t whole("2 * 3 + 4");
+  whole.compile(scope);
+  BOOST_REQUIRE(whole.get_op()->is_value());
+  BOOST_CHECK_EQUAL(value_t(10L), whole.get_op()->as_value());
+
+  expr_t part("(1 + 2) * amount");
+  part.compile(scope);
+  expr_t::ptr_op_t op(part.get_op());
+  BOOST_REQUIRE(op->kind == expr_t::op_t::O_MUL);
+  BOOST_REQUIRE(op->left()->is_value());
+  BOOST_CHECK_EQUAL(value_t(3L), op->left()->as_value());
+  BOOST_CHECK_EQUAL(value_t(12L), part.calc(scope));
+}
+
+BOOST_AUTO_TEST_CASE(testCommonSubexpressions)
+{
+  int            calls = 0;
+  symbol_scope_t scope;
+  scope.define(symbol_t::FUNCTION, "amount",
+               WRAP_FUNCTOR(counting_amount_t(&calls)));
+
+  expr_t expr("(amount + 1) * (amount + 1)");
+  expr.compile(scope);
+  expr_t::ptr_op_t op(expr.get_op());
+  BOOST_REQUIRE(op->kind == expr_t::op_t::O_MUL);
+  BOOST_CHECK(op->left() == op->right());
+
+  // The shared operand is calculated once per evaluation of the whole
+  // expression, and again on the next evaluation.
+  BOOST_CHECK_EQUAL(value_t(25L), expr.calc(scope));
+  BOOST_CHECK_EQUAL(1, calls);
+  BOOST_CHECK_EQUAL(value_t(25L), expr.calc(scope));
+  BOOST_CHECK_EQUAL(2, calls);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
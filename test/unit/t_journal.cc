@@ -0,0 +1,515 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE data
+#include <boost/test/unit_test.hpp>
+
+#include <system.hh>
+
+#include "journal.h"
+#include "session.h"
+#include "pool.h"
+#include "xact.h"
+#include "post.h"
+#include "balance.h"
+
+using namespace ledger;
+
+struct journal_fixture {
+#ifndef NOT_FOR_PYTHON
+  std::auto_ptr<session_t> session;
+  std::set<path>           files;
+
+  // Write a journal file for a test, to be removed when it is done.
+  void write_file(const path& pathname, const string& contents) {
+    files.insert(pathname);
+    ofstream out(pathname);
+    out << contents;
+  }
+#endif // NOT_FOR_PYTHON
+
+  journal_fixture() {
+#ifndef NOT_FOR_PYTHON
+    session.reset(new session_t);
+    set_session_context(session.get());
+    scope_t::default_scope = session.get();
+#endif // NOT_FOR_PYTHON
+  }
+
+  ~journal_fixture() {
+#ifndef NOT_FOR_PYTHON
+    foreach (const path& pathname, files)
+      if (exists(pathname))
+        remove(pathname);
+
+    scope_t::default_scope = NULL;
+    session.reset();
+    set_session_context(NULL);
+#endif // NOT_FOR_PYTHON
+  }
+};
+
+namespace {
+  const char * rollup_journal =
+    "2010/01/05 Paycheck\n"
+    "    Assets:Bank              $100\n"
+    "    Income:Salary\n"
+    "\n"
+    "2010/01/05 Grocer\n"
+    "    Expenses:Food             $10\n"
+    "    Assets:Bank\n"
+    "\n"
+    "2010/01/20 Gift\n"
+    "    Assets:Bank            50 EUR\n"
+    "    Income:Gift\n"
+    "\n"
+    "2010/01/31 Grocer\n"
+    "    Expenses:Food              $5\n"
+    "    Assets:Bank\n"
+    "\n"
+    "2010/02/01 Grocer\n"
+    "    Expenses:Food              $7\n"
+    "    Assets:Bank\n"
+    "\n"
+    "2010/02/10 Gift\n"
+    "    Assets:Bank            20 EUR\n"
+    "    Income:Gift\n"
+    "\n"
+    "2010/03/15 Interest\n"
+    "    Assets:Bank                $1\n"
+    "    Income:Salary\n";
+
+  balance_t account_total(const posts_list& posts, const string& name)
+  {
+    balance_t total;
+    foreach (post_t * post, posts)
+      if (post->account->fullname() == name)
+        total += post->amount;
+    return total;
+  }
+
+  // What the journal's own postings total before the given date.
+  balance_t journal_total(journal_t& journal, const date_t& end,
+                          const string& name)
+  {
+    posts_list posts;
+    foreach (xact_t * xact, journal.xacts)
+      foreach (post_t * post, xact->posts)
+        if (post->date() < end)
+          posts.push_back(post);
+    return account_total(posts, name);
+  }
+
+  balance_t make_balance(const char * first, const char * second = NULL)
+  {
+    balance_t total;
+    total += amount_t(first);
+    if (second)
+      total += amount_t(second);
+    return total;
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(journal, journal_fixture)
+
+BOOST_AUTO_TEST_CASE(testRefreshKeepsPriceDirectives)
+{
+#ifndef NOT_FOR_PYTHON
+  path prices("t_journal_prices.dat");
+  path buys("t_journal_buys.dat");
+  write_file(prices, "P 2010/01/05 AAPL $100\n");
+  write_file(buys, "2010/01/05 Buy\n"
+                   "    Assets:Brokerage        10 AAPL @ $120\n"
+                   "    Assets:Bank\n");
+
+  journal_t& journal(*session->journal);
+  journal.read(prices);
+  journal.read(buys);
+
+  commodity_t * aapl   = commodity_pool_t::current_pool->find("AAPL");
+  commodity_t * dollar = commodity_pool_t::current_pool->find("$");
+  BOOST_REQUIRE(aapl && dollar);
+
+  datetime_t jan05 = parse_datetime("2010/01/05 00:00:00");
+  datetime_t jan06 = parse_datetime("2010/01/06 00:00:00");
+
+  optional<price_point_t> point = aapl->find_price(*dollar, jan05);
+  BOOST_REQUIRE(point);
+  BOOST_CHECK_EQUAL(amount_t("$120"), point->price);
+
+  // Moving the purchase to another day must bring back the price that the
+  // P directive set for the day it was made.
+  write_file(buys, "2010/01/06 Buy\n"
+                   "    Assets:Brokerage        10 AAPL @ $120\n"
+                   "    Assets:Bank\n");
+  std::set<path> touched;
+  touched.insert(buys);
+  BOOST_CHECK(journal.refresh(touched));
+
+  point = aapl->find_price(*dollar, jan05);
+  BOOST_REQUIRE(point);
+  BOOST_CHECK_EQUAL(amount_t("$100"), point->price);
+
+  point = aapl->find_price(*dollar, jan06);
+  BOOST_REQUIRE(point);
+  BOOST_CHECK_EQUAL(amount_t("$120"), point->price);
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testRefreshInPlace)
+{
+#ifndef NOT_FOR_PYTHON
+  path first("t_journal_first.dat");
+  path second("t_journal_second.dat");
+  path third("t_journal_third.dat");
+  write_file(first, "2010/01/01 First\n"
+                    "    Expenses:Food             $1\n"
+                    "    Assets:Cash\n");
+  write_file(second, "2010/01/02 Second\n"
+                     "    Expenses:Food             $2\n"
+                     "    Assets:Cash\n");
+  write_file(third, "2010/01/03 Third\n"
+                    "    Expenses:Food             $3\n"
+                    "    Assets:Cash\n");
+
+  journal_t& journal(*session->journal);
+  journal.read(first);
+  journal.read(second);
+  journal.read(third);
+
+  account_t * food = journal.find_account("Expenses:Food");
+  BOOST_REQUIRE(food);
+  BOOST_CHECK_EQUAL(3U, food->posts.size());
+
+  // The middle file now holds two xacts, which must take the place of
+  // its one old xact, ahead of the third file's.
+  write_file(second, "2010/01/02 Second\n"
+                     "    Expenses:Food            $20\n"
+                     "    Assets:Cash\n"
+                     "\n"
+                     "2010/01/04 Fourth\n"
+                     "    Expenses:Food            $40\n"
+                     "    Assets:Cash\n");
+  std::set<path> touched;
+  touched.insert(second);
+  BOOST_CHECK(journal.refresh(touched));
+
+  BOOST_REQUIRE_EQUAL(4U, journal.xacts.size());
+  xacts_list::iterator i = journal.xacts.begin();
+  BOOST_CHECK_EQUAL(string("First"),  (*i++)->payee);
+  BOOST_CHECK_EQUAL(string("Second"), (*i++)->payee);
+  BOOST_CHECK_EQUAL(string("Fourth"), (*i++)->payee);
+  BOOST_CHECK_EQUAL(string("Third"),  (*i++)->payee);
+
+  // The old xact's posting was unhooked from its account, which holds
+  // only the postings of xacts still in the journal.
+  BOOST_CHECK_EQUAL(4U, food->posts.size());
+  amount_t total;
+  foreach (post_t * post, food->posts) {
+    BOOST_CHECK(std::find(journal.xacts.begin(), journal.xacts.end(),
+                          post->xact) != journal.xacts.end());
+    total += post->amount;
+  }
+  BOOST_CHECK_EQUAL(amount_t("$64"), total);
+
+  // The middle file's sources entry describes what was read again.
+  std::size_t listed = 0;
+  foreach (const journal_t::fileinfo_t& info, journal.sources) {
+    if (info.filename && *info.filename == second) {
+      BOOST_CHECK_EQUAL(file_size(second), info.size);
+      listed++;
+    }
+  }
+  BOOST_CHECK_EQUAL(1U, listed);
+
+  // Nothing changed since, so there is nothing to do.
+  BOOST_CHECK(journal.refresh());
+  BOOST_CHECK_EQUAL(4U, journal.xacts.size());
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testRefreshBeforeDirectives)
+{
+#ifndef NOT_FOR_PYTHON
+  path buys("t_journal_buys.dat");
+  path prices("t_journal_prices.dat");
+  write_file(buys, "2010/01/05 Buy\n"
+                   "    Assets:Brokerage        10 AAPL @ $120\n"
+                   "    Assets:Bank\n");
+  write_file(prices, "P 2010/01/05 AAPL $100\n");
+
+  journal_t& journal(*session->journal);
+  journal.read(buys);
+  journal.read(prices);
+
+  // A file read before one with other directives cannot be read again
+  // by itself, and neither can that file, so a full reload is needed.
+  write_file(buys, "2010/01/06 Buy\n"
+                   "    Assets:Brokerage        10 AAPL @ $120\n"
+                   "    Assets:Bank\n");
+  std::set<path> touched;
+  touched.insert(buys);
+  BOOST_CHECK(! journal.refresh(touched));
+
+  touched.clear();
+  touched.insert(prices);
+  BOOST_CHECK(! journal.refresh(touched));
+
+  // Declining leaves the journal as it was.
+  BOOST_REQUIRE_EQUAL(1U, journal.xacts.size());
+  BOOST_CHECK_EQUAL(parse_date("2010/01/05"), journal.xacts.front()->date());
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testRefreshUnaccountedXacts)
+{
+#ifndef NOT_FOR_PYTHON
+  path buys("t_journal_buys.dat");
+  write_file(buys, "2010/01/05 Buy\n"
+                   "    Assets:Brokerage        10 AAPL @ $120\n"
+                   "    Assets:Bank\n");
+
+  journal_t& journal(*session->journal);
+  journal.read(buys);
+
+  // Xacts read from a stream belong to no file, so where the changed
+  // file's xacts are among them cannot be known.
+  std::istringstream in("2010/01/07 Fees\n"
+                        "    Expenses:Fees              $5\n"
+                        "    Assets:Bank\n");
+  journal.read(in, path("t_journal_stream"));
+
+  write_file(buys, "2010/01/06 Buy\n"
+                   "    Assets:Brokerage        10 AAPL @ $120\n"
+                   "    Assets:Bank\n");
+  std::set<path> touched;
+  touched.insert(buys);
+  BOOST_CHECK(! journal.refresh(touched));
+  BOOST_CHECK_EQUAL(2U, journal.xacts.size());
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testPostsByDate)
+{
+#ifndef NOT_FOR_PYTHON
+  std::istringstream in("2010/01/01 January\n"
+                        "    Expenses:Food            $10\n"
+                        "    Assets:Cash\n"
+                        "\n"
+                        "2010/01/15 Mid-January\n"
+                        "    Expenses:Food            $20\n"
+                        "    Assets:Cash\n"
+                        "\n"
+                        "2010/02/01 February\n"
+                        "    Expenses:Food            $30\n"
+                        "    Assets:Cash\n"
+                        "\n"
+                        "2009/12/31 Late entry\n"
+                        "    Expenses:Food            $40\n"
+                        "    Assets:Cash\n");
+
+  journal_t& journal(*session->journal);
+  journal.read(in, path("t_journal_dates"));
+
+  // The slice is bounded below inclusively and above exclusively, and
+  // comes back in journal order whatever order the dates are in.
+  journal_t::post_sequences_t sequences;
+  journal.posts_by_date(parse_date("2010/01/01"), parse_date("2010/02/01"),
+                        sequences);
+  BOOST_REQUIRE_EQUAL(4U, sequences.size());
+  BOOST_CHECK_EQUAL(0U, sequences[0]);
+  BOOST_CHECK_EQUAL(1U, sequences[1]);
+  BOOST_CHECK_EQUAL(2U, sequences[2]);
+  BOOST_CHECK_EQUAL(3U, sequences[3]);
+
+  sequences.clear();
+  journal.posts_by_date(none, parse_date("2010/01/01"), sequences);
+  BOOST_REQUIRE_EQUAL(2U, sequences.size());
+  BOOST_CHECK_EQUAL(6U, sequences[0]);
+  BOOST_CHECK_EQUAL(7U, sequences[1]);
+
+  sequences.clear();
+  journal.posts_by_date(parse_date("2010/01/15"), none, sequences);
+  BOOST_REQUIRE_EQUAL(4U, sequences.size());
+
+  posts_list posts;
+  journal.posts_by_sequence(sequences, posts);
+  BOOST_REQUIRE_EQUAL(4U, posts.size());
+  BOOST_CHECK_EQUAL(string("Mid-January"), posts.front()->xact->payee);
+  BOOST_CHECK_EQUAL(string("February"), posts.back()->xact->payee);
+
+  sequences.clear();
+  journal.posts_by_date(parse_date("2010/02/02"), none, sequences);
+  BOOST_CHECK(sequences.empty());
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testPostsByKey)
+{
+#ifndef NOT_FOR_PYTHON
+  std::istringstream in("2010/01/01 (101) Grocer\n"
+                        "    ; :food:\n"
+                        "    Expenses:Food            $10\n"
+                        "    Assets:Cash\n"
+                        "\n"
+                        "2010/01/02 Cafe\n"
+                        "    Expenses:Food            $20  ; :dining:\n"
+                        "    Assets:Cash\n"
+                        "\n"
+                        "2010/01/03 (102) Grocer\n"
+                        "    Expenses:Food            10 EUR\n"
+                        "    Assets:Euro\n");
+
+  journal_t& journal(*session->journal);
+  journal.read(in, path("t_journal_keys"));
+
+  // Only the index a query asks for is built.
+  journal_t::post_sequences_t sequences;
+  journal.posts_by_key(journal_t::PAYEE_INDEX, string("Grocer"), sequences);
+  BOOST_CHECK(journal.keys_indexed[journal_t::PAYEE_INDEX]);
+  BOOST_CHECK(! journal.keys_indexed[journal_t::TAG_INDEX]);
+  BOOST_CHECK(! journal.keys_indexed[journal_t::CODE_INDEX]);
+  BOOST_CHECK(! journal.keys_indexed[journal_t::COMMODITY_INDEX]);
+  BOOST_REQUIRE_EQUAL(4U, sequences.size());
+  BOOST_CHECK_EQUAL(0U, sequences[0]);
+  BOOST_CHECK_EQUAL(5U, sequences[3]);
+
+  sequences.clear();
+  journal.posts_by_key(journal_t::PAYEE_INDEX, mask_t("^gro|caf"), sequences);
+  BOOST_CHECK_EQUAL(6U, sequences.size());
+
+  // Tags on an xact are inherited by all of its postings.
+  sequences.clear();
+  journal.posts_by_key(journal_t::TAG_INDEX, mask_t("food"), sequences);
+  BOOST_REQUIRE_EQUAL(2U, sequences.size());
+  BOOST_CHECK_EQUAL(0U, sequences[0]);
+  BOOST_CHECK_EQUAL(1U, sequences[1]);
+
+  sequences.clear();
+  journal.posts_by_key(journal_t::TAG_INDEX, mask_t("dining"), sequences);
+  BOOST_REQUIRE_EQUAL(1U, sequences.size());
+  BOOST_CHECK_EQUAL(2U, sequences[0]);
+
+  sequences.clear();
+  journal.posts_by_key(journal_t::CODE_INDEX, string("102"), sequences);
+  BOOST_REQUIRE_EQUAL(2U, sequences.size());
+  BOOST_CHECK_EQUAL(4U, sequences[0]);
+
+  sequences.clear();
+  journal.posts_by_key(journal_t::COMMODITY_INDEX, string("EUR"), sequences);
+  BOOST_REQUIRE_EQUAL(2U, sequences.size());
+  BOOST_CHECK_EQUAL(4U, sequences[0]);
+  BOOST_CHECK_EQUAL(5U, sequences[1]);
+
+  sequences.clear();
+  journal.posts_by_key(journal_t::PAYEE_INDEX, string("Nobody"), sequences);
+  BOOST_CHECK(sequences.empty());
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testRollupsByDate)
+{
+#ifndef NOT_FOR_PYTHON
+  std::istringstream in(rollup_journal);
+  journal_t& journal(*session->journal);
+  journal.read(in, path("t_journal_rollups"));
+
+  // Both January 5th xacts post to Assets:Bank in dollars, so that day
+  // has one rollup for it, netting them.
+  posts_list posts;
+  journal.rollups_by_date(parse_date("2010/01/05"), parse_date("2010/01/06"),
+                          posts);
+  BOOST_CHECK_EQUAL(3U, posts.size());
+  BOOST_CHECK_EQUAL(make_balance("$90"), account_total(posts, "Assets:Bank"));
+  BOOST_CHECK_EQUAL(make_balance("$-100"),
+                    account_total(posts, "Income:Salary"));
+  BOOST_CHECK_EQUAL(make_balance("$10"), account_total(posts, "Expenses:Food"));
+
+  // Rollups in another commodity are kept apart.
+  posts.clear();
+  journal.rollups_by_date(none, parse_date("2010/02/01"), posts);
+  BOOST_CHECK_EQUAL(make_balance("$85", "50 EUR"),
+                    account_total(posts, "Assets:Bank"));
+
+  posts.clear();
+  journal.rollups_by_date(parse_date("2010/02/01"), parse_date("2010/03/01"),
+                          posts);
+  BOOST_CHECK_EQUAL(make_balance("$-7", "20 EUR"),
+                    account_total(posts, "Assets:Bank"));
+  BOOST_CHECK_EQUAL(make_balance("-20 EUR"),
+                    account_total(posts, "Income:Gift"));
+
+  // Over the whole journal, the rollups total what the postings do.
+  posts.clear();
+  journal.rollups_by_date(none, none, posts);
+  date_t after = parse_date("2011/01/01");
+  BOOST_CHECK_EQUAL(journal_total(journal, after, "Assets:Bank"),
+                    account_total(posts, "Assets:Bank"));
+  BOOST_CHECK_EQUAL(journal_total(journal, after, "Expenses:Food"),
+                    account_total(posts, "Expenses:Food"));
+  BOOST_CHECK_EQUAL(journal_total(journal, after, "Income:Gift"),
+                    account_total(posts, "Income:Gift"));
+  BOOST_CHECK_EQUAL(journal_total(journal, after, "Income:Salary"),
+                    account_total(posts, "Income:Salary"));
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_CASE(testBalancePosts)
+{
+#ifndef NOT_FOR_PYTHON
+  std::istringstream in(rollup_journal);
+  journal_t& journal(*session->journal);
+  journal.read(in, path("t_journal_balances"));
+
+  // Exactly on a checkpoint's boundary, its balances are all there is.
+  posts_list posts;
+  std::size_t count = journal.balance_posts(parse_date("2010/02/01"), posts);
+  BOOST_CHECK_EQUAL(posts.size(), count);
+  BOOST_CHECK_EQUAL(make_balance("$85", "50 EUR"),
+                    account_total(posts, "Assets:Bank"));
+  BOOST_CHECK_EQUAL(make_balance("$15"), account_total(posts, "Expenses:Food"));
+
+  // Within a month, the postings since its checkpoint follow the balances.
+  posts.clear();
+  count = journal.balance_posts(parse_date("2010/02/11"), posts);
+  BOOST_CHECK_EQUAL(5U, count);
+  BOOST_CHECK_EQUAL(count + 4, posts.size());
+  BOOST_CHECK_EQUAL(make_balance("$78", "70 EUR"),
+                    account_total(posts, "Assets:Bank"));
+  BOOST_CHECK_EQUAL(make_balance("$22"), account_total(posts, "Expenses:Food"));
+  BOOST_CHECK_EQUAL(make_balance("-70 EUR"),
+                    account_total(posts, "Income:Gift"));
+
+  // Before the first checkpoint there are only postings.
+  posts.clear();
+  count = journal.balance_posts(parse_date("2010/01/31"), posts);
+  BOOST_CHECK_EQUAL(0U, count);
+  BOOST_CHECK_EQUAL(make_balance("$90", "50 EUR"),
+                    account_total(posts, "Assets:Bank"));
+  BOOST_CHECK_EQUAL(make_balance("$10"), account_total(posts, "Expenses:Food"));
+
+  // Whichever checkpoint is used, the totals agree with the postings.
+  const char * ends[] = { "2010/01/06", "2010/03/01", "2010/03/15",
+                          "2010/03/16", "2011/01/01" };
+  for (std::size_t i = 0; i < sizeof(ends) / sizeof(ends[0]); i++) {
+    date_t end = parse_date(ends[i]);
+    posts.clear();
+    journal.balance_posts(end, posts);
+    BOOST_CHECK_EQUAL(journal_total(journal, end, "Assets:Bank"),
+                      account_total(posts, "Assets:Bank"));
+    BOOST_CHECK_EQUAL(journal_total(journal, end, "Expenses:Food"),
+                      account_total(posts, "Expenses:Food"));
+    BOOST_CHECK_EQUAL(journal_total(journal, end, "Income:Gift"),
+                      account_total(posts, "Income:Gift"));
+    BOOST_CHECK_EQUAL(journal_total(journal, end, "Income:Salary"),
+                      account_total(posts, "Income:Salary"));
+  }
+
+  posts.clear();
+  journal.balance_posts(parse_date("2011/01/01"), posts);
+  BOOST_CHECK_EQUAL(make_balance("$79", "70 EUR"),
+                    account_total(posts, "Assets:Bank"));
+  BOOST_CHECK_EQUAL(make_balance("$-101"),
+                    account_total(posts, "Income:Salary"));
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,137 @@
+#define BOOST_TEST_DYN_LINK
+//#define BOOST_TEST_MODULE report
+#include <boost/test/unit_test.hpp>
+
+#include <system.hh>
+
+#include "journal.h"
+#include "session.h"
+#include "report.h"
+#include "output.h"
+#include "filters.h"
+#include "iterators.h"
+
+using namespace ledger;
+
+struct report_fixture {
+#ifndef NOT_FOR_PYTHON
+  std::auto_ptr<session_t> session;
+  std::auto_ptr<report_t>  report;
+#endif // NOT_FOR_PYTHON
+
+  report_fixture() {
+#ifndef NOT_FOR_PYTHON
+    session.reset(new session_t);
+    set_session_context(session.get());
+    report.reset(new report_t(*session));
+    scope_t::default_scope = report.get();
+#endif // NOT_FOR_PYTHON
+  }
+
+  ~report_fixture() {
+#ifndef NOT_FOR_PYTHON
+    scope_t::default_scope = NULL;
+    report.reset();
+    session.reset();
+    set_session_context(NULL);
+#endif // NOT_FOR_PYTHON
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(balance_report, report_fixture)
+
+BOOST_AUTO_TEST_CASE(testCheckpointsKeepCustomFormats)
+{
+#ifndef NOT_FOR_PYTHON
+  path journal_file("t_report.dat");
+  {
+    ofstream out(journal_file);
+    out << "2010/01/05 Grocer\n"
+        << "    Food                      $10\n"
+        << "    Cash\n"
+        << "\n"
+        << "2010/01/20 Grocer\n"
+        << "    Food                      $20\n"
+        << "    Cash\n"
+        << "\n"
+        << "2010/02/03 Grocer\n"
+        << "    Food                      $12\n"
+        << "    Cash\n"
+        << "\n"
+        << "2010/03/10 Grocer\n"
+        << "    Food                       $5\n"
+        << "    Cash\n";
+  }
+  session->resident = true;
+  session->journal->read(journal_file);
+  remove(journal_file);
+
+  // As of the middle of March, a balance could start from the checkpoint
+  // on March 1st, which holds one posting per account in place of three.
+  // A format that counts postings must see all four.
+  report->HANDLER(limit_).on(string("--end"), "date<[2010-03-15]");
+  report->HANDLER(format_).on(string("--format"), "%(count) %(account)\n");
+
+  std::ostringstream * out = new std::ostringstream;
+  report->output_stream.os = out;
+  report->accounts_report
+    (acct_handler_ptr(new format_accounts
+                      (*report,
+                       report->report_format
+                       (report->HANDLER(balance_format_)))));
+
+  string text(out->str());
+  BOOST_CHECK(text.find("4 Cash\n") != string::npos);
+  BOOST_CHECK(text.find("4 Food\n") != string::npos);
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE(sort_runs, report_fixture)
+
+BOOST_AUTO_TEST_CASE(testSortPastOpenRuns)
+{
+#ifndef NOT_FOR_PYTHON
+  // At the smallest budget a run holds a couple of dozen postings, so
+  // these spill several times more runs than may be open at once.
+  path journal_file("t_report.dat");
+  {
+    ofstream out(journal_file);
+    for (int i = 0; i < 3000; i++) {
+      char payee[16];
+      std::sprintf(payee, "P%04d", (i * 7919) % 1000);
+      out << "2010/01/01 " << payee << "\n"
+          << "    Expenses:Food              $" << (i + 1) << "\n"
+          << "    Assets:Cash\n"
+          << "\n";
+    }
+  }
+  session->journal->read(journal_file);
+  remove(journal_file);
+
+  posts_list sorted;
+  {
+    post_handler_ptr sorter
+      (new sort_posts(post_handler_ptr(new push_to_posts_list(sorted)),
+                      "payee", 1));
+    journal_posts_iterator walker(*session->journal);
+    pass_down_posts<journal_posts_iterator>(sorter, walker);
+  }
+
+  // Payees repeat, and equal payees must keep the journal's order, which
+  // is also the order of their amounts' magnitudes.
+  BOOST_REQUIRE_EQUAL(6000UL, sorted.size());
+  post_t * last = NULL;
+  foreach (post_t * post, sorted) {
+    if (last) {
+      BOOST_REQUIRE(last->payee() <= post->payee());
+      if (last->payee() == post->payee())
+        BOOST_REQUIRE(last->amount.abs() <= post->amount.abs());
+    }
+    last = post;
+  }
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE report
+#include <boost/test/unit_test.hpp>
+
+#include <system.hh>
+
+#include "xml.h"
+#include "journal.h"
+#include "session.h"
+#include "report.h"
+
+using namespace ledger;
+
+struct xml_fixture {
+#ifndef NOT_FOR_PYTHON
+  std::auto_ptr<session_t> session;
+  std::auto_ptr<report_t>  report;
+#endif // NOT_FOR_PYTHON
+
+  xml_fixture() {
+#ifndef NOT_FOR_PYTHON
+    session.reset(new session_t);
+    set_session_context(session.get());
+    report.reset(new report_t(*session));
+    scope_t::default_scope = report.get();
+#endif // NOT_FOR_PYTHON
+  }
+
+  ~xml_fixture() {
+#ifndef NOT_FOR_PYTHON
+    scope_t::default_scope = NULL;
+    report.reset();
+    session.reset();
+    set_session_context(NULL);
+#endif // NOT_FOR_PYTHON
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(xml, xml_fixture)
+
+BOOST_AUTO_TEST_CASE(testTransactionsWrittenOnce)
+{
+#ifndef NOT_FOR_PYTHON
+  path journal_file("t_xml.dat");
+  {
+    ofstream out(journal_file);
+    out << "2010/01/01 Opening\n"
+        << "    Assets:Bank             $1000\n"
+        << "    Assets:Cash               $50\n"
+        << "    Equity:Opening\n"
+        << "\n"
+        << "2010/01/02 Groceries\n"
+        << "    Expenses:Food             $50\n"
+        << "    Assets:Cash\n";
+  }
+  session->journal->read(journal_file);
+  remove(journal_file);
+
+  std::ostringstream * out = new std::ostringstream;
+  report->output_stream.os = out;
+  report->posts_report(post_handler_ptr(new format_xml(*report)));
+
+  string text(out->str());
+
+  std::size_t count = 0;
+  for (string::size_type pos = text.find("<transaction>");
+       pos != string::npos;
+       pos = text.find("<transaction>", pos + 1))
+    count++;
+  BOOST_CHECK_EQUAL(2UL, count);
+
+  string::size_type opening = text.find("<payee>Opening</payee>");
+  BOOST_REQUIRE(opening != string::npos);
+  BOOST_CHECK(text.find("<payee>Opening</payee>", opening + 1) ==
+              string::npos);
+
+  // All three postings of the first transaction are within its element.
+  string::size_type close = text.find("</transaction>", opening);
+  BOOST_REQUIRE(close != string::npos);
+  string first(text, opening, close - opening);
+  BOOST_CHECK(first.find("<name>Assets:Bank</name>") != string::npos);
+  BOOST_CHECK(first.find("<name>Assets:Cash</name>") != string::npos);
+  BOOST_CHECK(first.find("<name>Equity:Opening</name>") != string::npos);
+
+  // The accounts and commodities, known only at the end, follow.
+  BOOST_CHECK(text.find("</transactions>") < text.find("<commodities>"));
+  BOOST_CHECK(text.find("<commodities>") < text.find("<accounts>"));
+#endif // NOT_FOR_PYTHON
+}
+
+BOOST_AUTO_TEST_SUITE_END()